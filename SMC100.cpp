@@ -1,12 +1,30 @@
 #include "SMC100.h"
+#include "SMC100Bus.h"
+#if SMC100UseEEPROMCache
+#include <EEPROM.h>
+#endif
 
 const char SMC100::CarriageReturnCharacter = '\r';
 const char SMC100::NewLineCharacter = '\n';
 const char SMC100::GetCharacter = '?';
 const char SMC100::NoErrorCharacter = '@';
 const uint32_t SMC100::WipeInputEvery = 100000;
+const uint32_t SMC100::LimitQueryEvery = 500000;
 const uint32_t SMC100::CommandReplyTimeMax = 500000;
+const uint32_t SMC100::CommandReplyTimeMin = 10000;
+const uint8_t SMC100::CommandReplyTimeFactor = 4;
 const uint32_t SMC100::WaitAfterSendingTimeMax = 20000;
+const uint16_t SMC100::TurnaroundDefault = 5000;
+const uint16_t SMC100::TurnaroundMin = 200;
+const uint16_t SMC100::TurnaroundMax = 50000;
+const uint8_t SMC100::TurnaroundFilterShift = 3;
+const uint8_t SMC100::BitsPerSerialByte = 10;
+const uint8_t SMC100::TypicalFrameBytes = 12;
+const uint32_t SMC100::ResetTime = 1000000;
+const uint32_t SMC100::ConfigurationSaveTime = 10000000;
+const float SMC100::ConfigurationTolerance = 0.00001;
+const uint32_t SMC100::ScanReplyTimeMax = 20000;
+const uint8_t SMC100::AddressMax = 31;
 
 const SMC100::CommandStruct SMC100::CommandLibrary[] =
 {
@@ -27,7 +45,21 @@ const SMC100::CommandStruct SMC100::CommandLibrary[] =
 	{CommandType::PositionReal,"TP",CommandParameterType::None,CommandGetSetType::GetAlways},
 	{CommandType::KeypadEnable,"JM",CommandParameterType::Int,CommandGetSetType::GetSet},
 	{CommandType::ErrorCommands,"TE",CommandParameterType::None,CommandGetSetType::GetAlways},
-	{CommandType::ErrorHardware,"TS",CommandParameterType::None,CommandGetSetType::GetAlways}
+	{CommandType::ErrorHardware,"TS",CommandParameterType::None,CommandGetSetType::GetAlways},
+	{CommandType::Velocity,"VA",CommandParameterType::Float,CommandGetSetType::GetSet},
+	{CommandType::Acceleration,"AC",CommandParameterType::Float,CommandGetSetType::GetSet},
+	{CommandType::Backlash,"BA",CommandParameterType::Float,CommandGetSetType::GetSet},
+	{CommandType::JerkTime,"JR",CommandParameterType::Float,CommandGetSetType::GetSet}
+};
+
+const SMC100::CommandType SMC100::ConfigurationCommands[] =
+{
+	CommandType::Velocity,
+	CommandType::Acceleration,
+	CommandType::LimitNegative,
+	CommandType::LimitPositive,
+	CommandType::Backlash,
+	CommandType::JerkTime,
 };
 
 const SMC100::StatusCharSet SMC100::StatusLibrary[] =
@@ -55,9 +87,10 @@ const SMC100::StatusCharSet SMC100::StatusLibrary[] =
 	{"47",StatusType::Jogging},
 };
 
-SMC100::SMC100(HardwareSerial *serial, uint8_t address)
+SMC100::SMC100(Stream* serial, uint8_t address)
 {
 	SerialPort = serial;
+	Bus = NULL;
 	Address = address;
 	CurrentCommand = NULL;
 	CurrentCommandParameter = 0.0;
@@ -74,6 +107,18 @@ SMC100::SMC100(HardwareSerial *serial, uint8_t address)
 	MoveCompleteCallback = NULL;
 	HomeCompleteCallback = NULL;
 	GPIOReturnCallback = NULL;
+	ProfileCompleteCallback = NULL;
+	ConfigurationCompleteCallback = NULL;
+	ConfigurationStage = ConfigurationStageType::None;
+	ConfigurationReadMask = 0;
+	ConfigurationChanges = 0;
+	ConfigurationFailed = false;
+	memset(&CurrentConfiguration, 0, sizeof(CurrentConfiguration));
+	memset(&TargetConfiguration, 0, sizeof(TargetConfiguration));
+	Recorder = NULL;
+	Verbose = true;
+	ContinuousPolling = true;
+	ClearErrorCounts();
 	NeedToFireMoveComplete = false;
 	NeedToFireHomeComplete = false;
 	CurrentCommand = NULL;
@@ -82,21 +127,193 @@ SMC100::SMC100(HardwareSerial *serial, uint8_t address)
 	Position = 0.0;
 	PositionLimitNegative = 0.0;
 	PositionLimitPositive = 0.0;
+	LimitNegativeValid = false;
+	LimitPositiveValid = false;
+	LimitQueryTime = 0;
+	Starting = false;
+	BeginTime = 0;
+	StartupTime = 0;
+	ConfigurationCacheAddress = -1;
+	ProfileTail = 0;
+	ProfileCount = 0;
+	ProfileRunning = false;
+	TriggerCount = 0;
+	TriggerMotionSeen = false;
+	MoveTarget = 0.0;
+	MoveTargetValid = false;
+	TriggerLanding = -1;
+	SampleCount = 0;
+	ProfileStartTime = 0;
+	ProfileVelocity = 0.0;
+	ProfileVelocitySaved = 0.0;
+	ProfileVelocitySavedValid = false;
+	ProfileReadingVelocity = false;
+	ProfileReadingPosition = false;
+	ProfileCheckingErrors = false;
+	ProfileErrorsChecked = false;
+	ProfileFailed = false;
+	ProfileMovePending = false;
+	ProfileMoveTarget = 0.0;
+	CurrentCommandSkipFollowUp = false;
+	TrackingError = 0.0;
+	TrackingErrorMax = 0.0;
 	LastWipeTime = 0;
 	TransmitTime = 0;
+	TransmitBytes = 0;
+	FollowUpFor = CommandType::None;
+	FollowUpTransmitTime = 0;
+	FollowUpBytes = 0;
+	CommandReplyTime = CommandReplyTimeMax;
+	WaitAfterSendingTime = WaitAfterSendingTimeMax;
+	for (uint8_t Index = 0; Index < SMC100CommandTypeCount; ++Index)
+	{
+		Turnaround[Index] = TurnaroundDefault;
+	}
+	SetBaudRate(SMC100DefaultBaudRate);
 	Mode = ModeType::Inactive;
 	Status = StatusType::Unknown;
+	StatusCount = 0;
+}
+
+SMC100::SMC100(SMC100Bus* bus, uint8_t address) : SMC100(bus->GetStream(), address)
+{
+	//Axes sharing one serial port go through the bus, which lets only one of them talk at a time.
+	Bus = bus;
+	Bus->Attach(this);
+}
+
+uint32_t SMC100::ScanBus(Stream* serial, uint8_t FirstAddress, uint8_t LastAddress)
+{
+	//Blocking, intended for setup(). Bit n of the result is set when address n answered TS.
+	uint32_t Found = 0;
+	char Buffer[SMC100ReplyBufferSize];
+	if (FirstAddress < 1)
+	{
+		FirstAddress = 1;
+	}
+	if (LastAddress > AddressMax)
+	{
+		LastAddress = AddressMax;
+	}
+	for (uint8_t ScanAddress = FirstAddress; ScanAddress <= LastAddress; ++ScanAddress)
+	{
+		while (serial->available())
+		{
+			serial->read();
+		}
+		serial->print(ScanAddress);
+		serial->write('T');
+		serial->write('S');
+		serial->write(CarriageReturnCharacter);
+		serial->write(NewLineCharacter);
+		uint8_t BufferIndex = 0;
+		bool Done = false;
+		uint32_t StartTime = micros();
+		while ( !Done && ((micros() - StartTime) < ScanReplyTimeMax) )
+		{
+			if (serial->available())
+			{
+				char NewChar = serial->read();
+				if (NewChar == NewLineCharacter)
+				{
+					Buffer[BufferIndex] = '\0';
+					char* EndOfAddress;
+					uint8_t AddressOfReply = strtol(Buffer, &EndOfAddress, 10);
+					if ( (AddressOfReply == ScanAddress) && (*EndOfAddress == 'T') && (*(EndOfAddress + 1) == 'S') )
+					{
+						bitSet(Found, ScanAddress);
+					}
+					Done = true;
+				}
+				else if ( (NewChar != CarriageReturnCharacter) && (BufferIndex < (SMC100ReplyBufferSize - 1)) )
+				{
+					Buffer[BufferIndex] = NewChar;
+					BufferIndex++;
+				}
+			}
+		}
+	}
+	return Found;
 }
 
 void SMC100::Begin()
 {
-	CommandQueuePut(CommandType::ErrorHardware, 0.0, CommandGetSetType::None);
-	CommandQueuePut(CommandType::LimitPositive, 0.0, CommandGetSetType::Get);
-	CommandQueuePut(CommandType::LimitNegative, 0.0, CommandGetSetType::Get);
+	//Queries are chained without the TE/TS follow up, the final TS refreshes status for all of them.
+	BeginTime = micros();
+	LimitQueryTime = BeginTime - LimitQueryEvery;
+	StartupTime = 0;
+	Starting = true;
+	if (!LoadConfigurationCache())
+	{
+		CommandQueuePut(CommandType::LimitPositive, 0.0, CommandGetSetType::Get);
+		CommandQueuePut(CommandType::LimitNegative, 0.0, CommandGetSetType::Get);
+	}
 	CommandQueuePut(CommandType::GPIOInput, 0.0, CommandGetSetType::None);
+	CommandQueuePut(CommandType::ErrorHardware, 0.0, CommandGetSetType::None);
 	Mode = ModeType::Idle;
 }
 
+bool SMC100::SetConfigurationCache(int EEPROMAddress)
+{
+	ConfigurationCacheAddress = EEPROMAddress;
+#if SMC100UseEEPROMCache
+	return true;
+#else
+	return false;
+#endif
+}
+
+void SMC100::SetBaudRate(uint32_t BaudRate)
+{
+	ByteTime = (BitsPerSerialByte * 1000000UL + BaudRate - 1) / BaudRate;
+}
+
+uint32_t SMC100::GetCommandTurnaround(CommandType Type)
+{
+	return Turnaround[static_cast<uint8_t>(Type)];
+}
+
+uint32_t SMC100::GetCommandLatency(CommandType Type)
+{
+	return SerialTime(TypicalFrameBytes) + Turnaround[static_cast<uint8_t>(Type)];
+}
+
+void SMC100::SetVerbose(bool Setting)
+{
+	Verbose = Setting;
+}
+
+const SMC100::ErrorCountStruct* SMC100::GetErrorCounts()
+{
+	return &ErrorCounts;
+}
+
+void SMC100::ClearErrorCounts()
+{
+	memset(&ErrorCounts, 0, sizeof(ErrorCounts));
+	OutOfSync = false;
+}
+
+void SMC100::SetRecorder(SMC100Recorder* NewRecorder)
+{
+	Recorder = NewRecorder;
+}
+
+bool SMC100::AreLimitsValid()
+{
+	return (LimitNegativeValid && LimitPositiveValid);
+}
+
+bool SMC100::IsStarting()
+{
+	return Starting;
+}
+
+uint32_t SMC100::GetStartupTime()
+{
+	return StartupTime;
+}
+
 bool SMC100::IsHomed()
 {
 	return HasBeenHomed;
@@ -138,6 +355,28 @@ bool SMC100::IsEnabled()
 	}
 }
 
+SMC100::StatusType SMC100::GetStatus()
+{
+	return Status;
+}
+
+uint32_t SMC100::GetStatusCount()
+{
+	//Counts TS replies, a caller compares it before and after a request to know the status is fresh.
+	return StatusCount;
+}
+
+void SMC100::SetContinuousPolling(bool Setting)
+{
+	//When off, Homing and Moving replies end the chain and the caller polls with SendGetStatus().
+	ContinuousPolling = Setting;
+}
+
+void SMC100::SendGetStatus()
+{
+	CommandQueuePut(CommandType::ErrorHardware, 0.0, CommandGetSetType::None);
+}
+
 void SMC100::Enable(bool Setting)
 {
 	float ParamterValue = 0.0;
@@ -153,12 +392,23 @@ bool SMC100::IsBusy()
 	return Busy;
 }
 
+bool SMC100::IsQueueFull()
+{
+	return CommandQueueFull();
+}
+
 void SMC100::Home()
 {
 	CommandQueuePut(CommandType::Home, 0.0, CommandGetSetType::None);
 }
 
 void SMC100::MoveAbsolute(float Target)
+{
+	//Clamped when it is pulled from the queue, which waits at the move until the limits are known.
+	CommandQueuePut(CommandType::MoveAbs, Target, CommandGetSetType::Set);
+}
+
+float SMC100::ClampToLimits(float Target)
 {
 	if (Target < PositionLimitNegative)
 	{
@@ -168,7 +418,7 @@ void SMC100::MoveAbsolute(float Target)
 	{
 		Target = PositionLimitPositive;
 	}
-	CommandQueuePut(CommandType::MoveAbs, Target, CommandGetSetType::Set);
+	return Target;
 }
 
 float SMC100::GetPosition()
@@ -229,8 +479,185 @@ void SMC100::SetGPIOReturnCallback(FinishedListener Callback)
 	GPIOReturnCallback = Callback;
 }
 
+void SMC100::SetProfileCompleteCallback(FinishedListener Callback)
+{
+	ProfileCompleteCallback = Callback;
+}
+
+void SMC100::SetConfigurationCompleteCallback(FinishedListener Callback)
+{
+	ConfigurationCompleteCallback = Callback;
+}
+
+void SMC100::ApplyConfiguration(const ConfigurationStruct* Configuration)
+{
+	//Reads every parameter first, then only a profile that differs enters PW and is saved to flash.
+	TargetConfiguration = *Configuration;
+	ConfigurationReadMask = 0;
+	ConfigurationChanges = 0;
+	ConfigurationFailed = false;
+	ConfigurationStage = ConfigurationStageType::Reading;
+	for (uint8_t Index = 0; Index < SMC100ConfigurationCount; ++Index)
+	{
+		CommandQueuePut(ConfigurationCommands[Index], 0.0, CommandGetSetType::Get);
+	}
+	CommandQueuePut(CommandType::ErrorHardware, 0.0, CommandGetSetType::None);
+}
+
+bool SMC100::IsConfiguring()
+{
+	return (ConfigurationStage != ConfigurationStageType::None);
+}
+
+uint8_t SMC100::GetConfigurationChanges()
+{
+	return ConfigurationChanges;
+}
+
+bool SMC100::IsConfigurationFailed()
+{
+	return ConfigurationFailed;
+}
+
+const SMC100::ConfigurationStruct* SMC100::GetConfiguration()
+{
+	return &CurrentConfiguration;
+}
+
+bool SMC100::ProfilePut(uint32_t Time, float Position, float Velocity)
+{
+	//Time is in microseconds from ProfileStart(), a velocity of zero is derived from the segment.
+	if (ProfileCount >= SMC100ProfileCount)
+	{
+		return false;
+	}
+	uint8_t Index = (ProfileTail + ProfileCount) % SMC100ProfileCount;
+	Profile[Index].Time = Time;
+	Profile[Index].Position = Position;
+	Profile[Index].Velocity = Velocity;
+	ProfileCount++;
+	return true;
+}
+
+uint8_t SMC100::ProfileSpace()
+{
+	return SMC100ProfileCount - ProfileCount;
+}
+
+void SMC100::ProfileStart()
+{
+	ProfileStartTime = micros();
+	ProfilePrevious.Time = 0;
+	ProfilePrevious.Position = Position;
+	ProfilePrevious.Velocity = 0.0;
+	ProfileActive = ProfilePrevious;
+	ProfileVelocity = 0.0;
+	ProfileMovePending = false;
+	ProfileCheckingErrors = false;
+	ProfileErrorsChecked = false;
+	ProfileFailed = false;
+	TrackingError = 0.0;
+	TrackingErrorMax = 0.0;
+	ProfileRunning = true;
+	//The velocity in use is restored when the profile ends, when no configuration has read it VA? is asked first.
+	ProfileVelocitySavedValid = ( (ConfigurationStage == ConfigurationStageType::None) && bitRead(ConfigurationReadMask, 0) );
+	ProfileVelocitySaved = CurrentConfiguration.Velocity;
+	ProfileReadingVelocity = !ProfileVelocitySavedValid;
+	if (ProfileReadingVelocity)
+	{
+		CommandQueuePut(CommandType::Velocity, 0.0, CommandGetSetType::Get);
+	}
+	//The first segment starts from a TP sent after this call, the clock starts once both replies are in.
+	ProfileReadingPosition = true;
+	CommandQueuePut(CommandType::PositionReal, 0.0, CommandGetSetType::None);
+}
+
+void SMC100::ProfileStop()
+{
+	if (ProfileRunning)
+	{
+		ProfileRestoreVelocity();
+	}
+	ProfileRunning = false;
+	ProfileReadingVelocity = false;
+	ProfileReadingPosition = false;
+	ProfileCheckingErrors = false;
+	ProfileMovePending = false;
+	ProfileTail = 0;
+	ProfileCount = 0;
+}
+
+bool SMC100::IsProfileRunning()
+{
+	return ProfileRunning;
+}
+
+bool SMC100::IsProfileFailed()
+{
+	return ProfileFailed;
+}
+
+bool SMC100::AddPositionTrigger(float Position, uint8_t Output)
+{
+	//Output is written to SB as the stage passes Position, in either direction.
+	if (TriggerCount >= SMC100TriggerCount)
+	{
+		return false;
+	}
+	TriggerStruct* Trigger = &Triggers[TriggerCount];
+	Trigger->Position = Position;
+	Trigger->Output = Output;
+	Trigger->Predicted = false;
+	Trigger->Fired = false;
+	Trigger->Crossed = false;
+	Trigger->Missed = false;
+	Trigger->PredictedTime = 0;
+	Trigger->LandTime = 0;
+	Trigger->LandMeasured = false;
+	Trigger->CrossingTime = 0;
+	Trigger->TimingError = 0;
+	TriggerCount++;
+	return true;
+}
+
+void SMC100::ClearPositionTriggers()
+{
+	TriggerCount = 0;
+	TriggerLanding = -1;
+	TriggerMotionSeen = false;
+}
+
+uint8_t SMC100::GetPositionTriggerCount()
+{
+	return TriggerCount;
+}
+
+const SMC100::TriggerStruct* SMC100::GetPositionTrigger(uint8_t Index)
+{
+	if (Index >= TriggerCount)
+	{
+		return NULL;
+	}
+	return &Triggers[Index];
+}
+
+float SMC100::GetTrackingError()
+{
+	return TrackingError;
+}
+
+float SMC100::GetTrackingErrorMax()
+{
+	return TrackingErrorMax;
+}
+
 void SMC100::Check()
 {
+	//On a bus the line is held from a send until its reply or time out, a set only holds it while it is written.
+	if ( (Bus != NULL) && !Bus->Acquire(this) )
+	{
+		return;
+	}
 	switch (Mode)
 	{
 		case ModeType::Idle:
@@ -245,15 +672,59 @@ void SMC100::Check()
 		default:
 			break;
 	}
+	if ( (Bus != NULL) && (Mode != ModeType::WaitForCommandReply) )
+	{
+		Bus->Release(this);
+	}
 }
 
 void SMC100::CheckCommandQueue()
 {
+	bool MoveHeld = ( !AreLimitsValid() && MoveAtQueueHead() );
+	if (!AreLimitsValid())
+	{
+		CheckLimits(MoveHeld);
+		if (Mode != ModeType::Idle)
+		{
+			return;
+		}
+	}
+	if (ProfileRunning)
+	{
+		CheckProfile();
+		if (Mode != ModeType::Idle)
+		{
+			return;
+		}
+	}
+	if (ConfigurationStage != ConfigurationStageType::None)
+	{
+		CheckConfiguration();
+	}
+	if ( TriggerMotionSeen && (Status != StatusType::Moving) )
+	{
+		ExpireTriggers();
+	}
+	if (TriggersArmed())
+	{
+		if (CheckTriggers())
+		{
+			return;
+		}
+	}
+	if (MoveHeld)
+	{
+		return;
+	}
 	bool NewCommandPulled = CommandQueuePullToCurrentCommand();
 	if (NewCommandPulled)
 	{
 		if (CurrentCommand != NULL)
 		{
+			if ( (CurrentCommand->Command == CommandType::MoveAbs) && (CurrentCommandGetOrSet == CommandGetSetType::Set) )
+			{
+				CurrentCommandParameter = ClampToLimits(CurrentCommandParameter);
+			}
 			Busy = true;
 			SendCurrentCommand();
 		}
@@ -264,7 +735,7 @@ void SMC100::CheckCommandQueue()
 	}
 	else
 	{
-		if (Busy)
+		if (Busy && !SampleMotion())
 		{
 			Busy = false;
 			if (AllCompleteCallback != NULL)
@@ -272,128 +743,643 @@ void SMC100::CheckCommandQueue()
 				AllCompleteCallback();
 			}
 		}
-		if ( (micros() - LastWipeTime) > WipeInputEvery )
+		if ( (Bus == NULL) && ((micros() - LastWipeTime) > WipeInputEvery) )
 		{
 			LastWipeTime = micros();
 			if (SerialPort->available())
 			{
-				//uint8_t ByteRead = SerialPort->read();
-				//Serial.print("J:");
-				//Serial.print(ByteRead);
-				//Serial.print("\n");
-				SerialPort->read();
+				uint8_t ByteRead = SerialPort->read();
+				if (Recorder != NULL)
+				{
+					Recorder->Record(LastWipeTime, Address, SMC100Recorder::DirectionType::Receive, ByteRead);
+				}
 			}
 		}
 	}
 }
 
-void SMC100::CheckWaitAfterSending()
+void SMC100::CheckLimits(bool MoveHeld)
 {
-	if ( (micros() - TransmitTime) > WaitAfterSendingTimeMax )
+	//A limit query that failed is repeated, ahead of a move waiting for the limits or once the queue drains.
+	if ( (!MoveHeld && !CommandQueueEmpty()) || ((micros() - LimitQueryTime) < LimitQueryEvery) )
 	{
-		SendErrorCommandRequest();
+		return;
 	}
-}
-
-void SMC100::CheckForCommandReply()
-{
-	if (SerialPort->available())
+	LimitQueryTime = micros();
+	Busy = true;
+	if (!LimitPositiveValid)
 	{
-		char NewChar = SerialPort->read();
-		if (NewChar == CarriageReturnCharacter)
-		{
-
-		}
-		else if (NewChar == NewLineCharacter)
-		{
-			ReplyBuffer[ReplyBufferIndex] = '\0';
-			ParseReply();
-		}
-		else
-		{
-			ReplyBuffer[ReplyBufferIndex] = NewChar;
-			ReplyBufferIndex++;
-			if (ReplyBufferIndex > SMC100ReplyBufferSize)
-			{
-				ReplyBuffer[SMC100ReplyBufferSize-1] = '\0';
-				Serial.print("<SMC100>(Error: Buffer overflow with ");
-				Serial.print(ReplyBuffer);
-				Serial.print(")\n");
-				Mode = ModeType::Idle;
-			}
-		}
+		SendGetLimitPositive();
 	}
-	if ( (micros() - TransmitTime) > CommandReplyTimeMax )
+	else
 	{
-		Mode = ModeType::Idle;
-		Serial.print("<SMC200>(Time out detected.)\n");
+		SendGetLimitNegative();
 	}
 }
 
-void SMC100::ParseReply()
+bool SMC100::MoveAtQueueHead()
 {
-	char* EndOfAddress;
-	char* ParameterAddress;
-	uint8_t AddressOfReply = strtol(ReplyBuffer, &EndOfAddress, 10);
-	if (AddressOfReply != Address)
-	{
-		Serial.print("<SMC100>(Address does not match return for ");
-		Serial.print(ReplyBuffer);
-		Serial.print(")\n");
-	}
-	else if ( (CurrentCommand->CommandChar[0] != *EndOfAddress) || (CurrentCommand->CommandChar[1] != *(EndOfAddress + 1)) )
+	if (CommandQueueEmpty())
 	{
-		Serial.print("<SMC100>(Return string expected ");
-		Serial.print(CurrentCommand->CommandChar[0]);
-		Serial.print(CurrentCommand->CommandChar[1]);
-		Serial.print(" but received ");
-		Serial.print(*EndOfAddress);
-		Serial.print(*(EndOfAddress + 1));
-		Serial.print(")\n");
+		return false;
 	}
-	else
+	const CommandQueueEntry* Head = &CommandQueue[CommandQueueTail];
+	return ( (Head->Command->Command == CommandType::MoveAbs) && (Head->GetOrSet == CommandGetSetType::Set) );
+}
+
+void SMC100::CheckConfiguration()
+{
+	if ( (ConfigurationStage == ConfigurationStageType::Reading) && CommandQueueEmpty() )
 	{
-		ParameterAddress = EndOfAddress + 2;
-		//char* EndOfReplyData = ReplyData + ReplyBufferIndex;
-		if (CurrentCommand->Command == CommandType::PositionReal)
+		if (ConfigurationReadMask != ((1 << SMC100ConfigurationCount) - 1))
 		{
-			Position = atof(ParameterAddress);
-			if (NeedToFireMoveComplete)
+			if (Verbose)
 			{
-				NeedToFireMoveComplete = false;
-				if (MoveCompleteCallback != NULL)
-				{
-					MoveCompleteCallback();
-				}
+				Serial.print("<SMC100>(Configuration read incomplete.)\n");
 			}
-			if (NeedToFireHomeComplete)
+			ConfigurationFailed = true;
+			ConfigurationStage = ConfigurationStageType::None;
+			if (ConfigurationCompleteCallback != NULL)
 			{
-				NeedToFireHomeComplete = false;
-				if (HomeCompleteCallback != NULL)
+				ConfigurationCompleteCallback();
+			}
+			return;
+		}
+		for (uint8_t Index = 0; Index < SMC100ConfigurationCount; ++Index)
+		{
+			CommandType Type = ConfigurationCommands[Index];
+			if (fabs(*ConfigurationField(&TargetConfiguration, Type) - *ConfigurationField(&CurrentConfiguration, Type)) > ConfigurationTolerance)
+			{
+				if (ConfigurationChanges == 0)
 				{
-					HomeCompleteCallback();
+					if (Status != StatusType::NoReference)
+					{
+						CommandQueuePut(CommandType::Reset, 0.0, CommandGetSetType::None);
+					}
+					CommandQueuePut(CommandType::Configure, 1.0, CommandGetSetType::Set);
 				}
+				CommandQueuePut(Type, *ConfigurationField(&TargetConfiguration, Type), CommandGetSetType::Set);
+				ConfigurationChanges++;
 			}
-			Mode = ModeType::Idle;
 		}
-		else if (CurrentCommand->Command == CommandType::ErrorCommands)
+		if (ConfigurationChanges == 0)
 		{
-			if (*ParameterAddress != NoErrorCharacter)
+			ConfigurationStage = ConfigurationStageType::None;
+			if (ConfigurationCompleteCallback != NULL)
 			{
-				Serial.print("<SMC100>(Error code: ");
-				Serial.print(*ParameterAddress);
-				Serial.print(")\n");
-				Mode = ModeType::Idle;
+				ConfigurationCompleteCallback();
 			}
-			else
+			return;
+		}
+		CommandQueuePut(CommandType::Configure, 0.0, CommandGetSetType::Set);
+		ConfigurationStage = ConfigurationStageType::Writing;
+	}
+	else if ( (ConfigurationStage == ConfigurationStageType::Writing) && CommandQueueEmpty() )
+	{
+		if (ConfigurationFailed)
+		{
+			//What the controller now holds is unknown, the limits are read back before moves resume.
+			if (Verbose)
 			{
-				SendErrorHardwareRequest();
+				Serial.print("<SMC100>(Configuration write failed.)\n");
 			}
+			ConfigurationReadMask = 0;
+			LimitNegativeValid = false;
+			LimitPositiveValid = false;
+			LimitQueryTime = micros() - LimitQueryEvery;
 		}
-		else if (CurrentCommand->Command == CommandType::ErrorHardware)
+		else
 		{
-			bool ErrorStatus = false;
-			char ErrorCode[4];
+			CurrentConfiguration = TargetConfiguration;
+			PositionLimitNegative = TargetConfiguration.LimitNegative;
+			PositionLimitPositive = TargetConfiguration.LimitPositive;
+			SaveConfigurationCache();
+		}
+		HasBeenHomed = false;
+		ConfigurationStage = ConfigurationStageType::None;
+		if (ConfigurationCompleteCallback != NULL)
+		{
+			ConfigurationCompleteCallback();
+		}
+	}
+}
+
+float* SMC100::ConfigurationField(ConfigurationStruct* Configuration, CommandType Type)
+{
+	switch (Type)
+	{
+		case CommandType::Velocity:
+			return &(Configuration->Velocity);
+		case CommandType::Acceleration:
+			return &(Configuration->Acceleration);
+		case CommandType::LimitNegative:
+			return &(Configuration->LimitNegative);
+		case CommandType::LimitPositive:
+			return &(Configuration->LimitPositive);
+		case CommandType::Backlash:
+			return &(Configuration->Backlash);
+		default:
+			return &(Configuration->JerkTime);
+	}
+}
+
+void SMC100::ConfigurationReceived(CommandType Type, float Value)
+{
+	if (ConfigurationStage != ConfigurationStageType::Reading)
+	{
+		return;
+	}
+	for (uint8_t Index = 0; Index < SMC100ConfigurationCount; ++Index)
+	{
+		if (ConfigurationCommands[Index] == Type)
+		{
+			*ConfigurationField(&CurrentConfiguration, Type) = Value;
+			bitSet(ConfigurationReadMask, Index);
+		}
+	}
+}
+
+void SMC100::QueryComplete()
+{
+	//Batched queries skip the TE follow up, the batch ends with its own TS.
+	if ( Starting || (ConfigurationStage == ConfigurationStageType::Reading) )
+	{
+		Mode = ModeType::Idle;
+	}
+	else
+	{
+		SendErrorCommandRequest();
+	}
+}
+
+void SMC100::CheckProfile()
+{
+	//Each setpoint is sent one command latency before the active segment ends, otherwise TP is polled for tracking.
+	if (ProfileReadingVelocity || ProfileReadingPosition)
+	{
+		if (!CommandQueueEmpty())
+		{
+			return;
+		}
+		//A reply was lost, the profile runs from the cached position and without restoring the velocity.
+		ProfileReadingVelocity = false;
+		ProfileReadingPosition = false;
+		ProfileStartTime = micros();
+	}
+	uint32_t Elapsed = micros() - ProfileStartTime;
+	if (ProfileMovePending)
+	{
+		ProfileMovePending = false;
+		SendProfileSetpoint(CommandType::MoveAbs, ProfileMoveTarget);
+		return;
+	}
+	if ( (ProfileCount > 0) && AreLimitsValid() )
+	{
+		const ProfilePointStruct* Next = &Profile[ProfileTail];
+		float NextVelocity = Next->Velocity;
+		if ( (NextVelocity <= 0.0) && (Next->Time > ProfileActive.Time) )
+		{
+			NextVelocity = fabs(Next->Position - ProfileActive.Position) * 1000000.0 / (float)(Next->Time - ProfileActive.Time);
+		}
+		bool SendVelocity = (NextVelocity > 0.0) && (NextVelocity != ProfileVelocity);
+		uint32_t Lead = GetCommandLatency(CommandType::MoveAbs);
+		if (SendVelocity)
+		{
+			Lead += GetCommandLatency(CommandType::Velocity);
+		}
+		if ( (Elapsed + Lead) >= ProfileActive.Time )
+		{
+			if (SendVelocity)
+			{
+				ProfileVelocity = NextVelocity;
+				ProfileMoveTarget = ClampToLimits(Next->Position);
+				ProfileMovePending = true;
+				SendProfileSetpoint(CommandType::Velocity, ProfileVelocity);
+			}
+			else
+			{
+				SendProfileSetpoint(CommandType::MoveAbs, ClampToLimits(Next->Position));
+			}
+			ProfilePrevious = ProfileActive;
+			ProfileActive = *Next;
+			ProfileTail = (ProfileTail + 1) % SMC100ProfileCount;
+			ProfileCount--;
+			return;
+		}
+		if ( (ProfileActive.Time - Lead - Elapsed) < GetCommandLatency(CommandType::PositionReal) )
+		{
+			return;
+		}
+	}
+	else if ( (ProfileCount == 0) && (Elapsed > ProfileActive.Time) && CommandQueueEmpty() )
+	{
+		//Setpoints skip TE, so it is asked once at the end and a rejected setpoint or a lost reply fails the profile.
+		if (!ProfileCheckingErrors)
+		{
+			ProfileCheckingErrors = true;
+			ProfileErrorsChecked = false;
+			Busy = true;
+			SendErrorCommandRequest();
+			return;
+		}
+		if (!ProfileErrorsChecked)
+		{
+			ProfileFailed = true;
+		}
+		ProfileCheckingErrors = false;
+		ProfileRunning = false;
+		ProfileRestoreVelocity();
+		if (ProfileCompleteCallback != NULL)
+		{
+			ProfileCompleteCallback();
+		}
+		return;
+	}
+	if (CommandQueueEmpty())
+	{
+		Busy = true;
+		SendPositionRequest();
+	}
+}
+
+void SMC100::SendProfileSetpoint(CommandType Type, float Parameter)
+{
+	//Setpoints go out ahead of the queue without the TE, TS and TP follow up, which the lead time does not cover.
+	Busy = true;
+	CommandCurrentPut(Type, Parameter, CommandGetSetType::Set);
+	SendCurrentCommand();
+	CurrentCommandSkipFollowUp = true;
+}
+
+void SMC100::ProfileRestoreVelocity()
+{
+	if (ProfileVelocitySavedValid && (ProfileVelocity != 0.0) && (ProfileVelocity != ProfileVelocitySaved))
+	{
+		CommandQueuePut(CommandType::Velocity, ProfileVelocitySaved, CommandGetSetType::Set);
+	}
+	ProfileVelocitySavedValid = false;
+}
+
+bool SMC100::SampleMotion()
+{
+	//Triggers only keep the axis sampling while it moves, so Busy clears once motion stops.
+	return ( ProfileRunning || (TriggersArmed() && (Status == StatusType::Moving)) );
+}
+
+bool SMC100::TriggersArmed()
+{
+	for (uint8_t Index = 0; Index < TriggerCount; ++Index)
+	{
+		if ( !Triggers[Index].Fired && !Triggers[Index].Missed )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool SMC100::CheckTriggers()
+{
+	//Holds the bus once the next trigger is closer than one TS and TP sample, then writes SB ahead of the queue.
+	int8_t Next = -1;
+	for (uint8_t Index = 0; Index < TriggerCount; ++Index)
+	{
+		if ( !Triggers[Index].Fired && Triggers[Index].Predicted && (Triggers[Index].Crossed || TriggerReachable(&Triggers[Index])) )
+		{
+			if ( (Next < 0) || ((int32_t)(Triggers[Index].PredictedTime - Triggers[Next].PredictedTime) < 0) )
+			{
+				Next = Index;
+			}
+		}
+	}
+	uint32_t Latency = GetCommandLatency(CommandType::GPIOOutput);
+	if (Next >= 0)
+	{
+		TriggerStruct* Trigger = &Triggers[Next];
+		int32_t TimeToSend = (int32_t)(Trigger->PredictedTime - Latency - micros());
+		if (TimeToSend <= 0)
+		{
+			//Land time is estimated from the learned latency until the TE after the SB measures it.
+			Trigger->Fired = true;
+			Trigger->LandTime = micros() + Latency;
+			if (Trigger->Crossed)
+			{
+				Trigger->TimingError = (int32_t)(Trigger->LandTime - Trigger->CrossingTime);
+			}
+			GPIOOutput = Trigger->Output;
+			Busy = true;
+			CommandCurrentPut(CommandType::GPIOOutput, (float)GPIOOutput, CommandGetSetType::Set);
+			SendCurrentCommand();
+			TriggerLanding = Next;
+			return true;
+		}
+		if ( (uint32_t)TimeToSend < (GetCommandLatency(CommandType::ErrorHardware) + GetCommandLatency(CommandType::PositionReal)) )
+		{
+			return true;
+		}
+	}
+	if ( (Status == StatusType::Moving) && CommandQueueEmpty() )
+	{
+		Busy = true;
+		SendErrorHardwareRequest();
+		return true;
+	}
+	return false;
+}
+
+bool SMC100::TriggerReachable(const TriggerStruct* Trigger)
+{
+	//Only a trigger between the stage and the PA target can be crossed, the rest are missed when motion stops.
+	if (!MoveTargetValid)
+	{
+		return true;
+	}
+	return ( ((Trigger->Position - Position) * (Trigger->Position - MoveTarget)) <= 0.0 );
+}
+
+void SMC100::ExpireTriggers()
+{
+	//A trigger still armed when the move that was sampling for it has stopped is reported as missed.
+	TriggerMotionSeen = false;
+	for (uint8_t Index = 0; Index < TriggerCount; ++Index)
+	{
+		if ( !Triggers[Index].Fired && !Triggers[Index].Missed )
+		{
+			Triggers[Index].Missed = true;
+			if (Verbose)
+			{
+				Serial.print("<SMC100>(Position trigger missed at ");
+				Serial.print(Triggers[Index].Position);
+				Serial.print(")\n");
+			}
+		}
+	}
+}
+
+void SMC100::TriggerTrackPosition()
+{
+	//Crossings are predicted by extrapolating the last two TP samples and measured by interpolating between them.
+	SamplePrevious = SampleLast;
+	SampleLast.Time = TransmitTime + (micros() - TransmitTime) / 2;
+	SampleLast.Position = Position;
+	if (SampleCount < 2)
+	{
+		SampleCount++;
+	}
+	if (SampleCount < 2)
+	{
+		return;
+	}
+	float Distance = SampleLast.Position - SamplePrevious.Position;
+	float Duration = (float)(SampleLast.Time - SamplePrevious.Time);
+	for (uint8_t Index = 0; Index < TriggerCount; ++Index)
+	{
+		TriggerStruct* Trigger = &Triggers[Index];
+		float ToPrevious = Trigger->Position - SamplePrevious.Position;
+		float ToLast = Trigger->Position - SampleLast.Position;
+		if ( !Trigger->Crossed && (Distance != 0.0) && ((ToPrevious * ToLast) <= 0.0) )
+		{
+			Trigger->Crossed = true;
+			Trigger->CrossingTime = SamplePrevious.Time + (uint32_t)(Duration * ToPrevious / Distance);
+			if (Trigger->Fired)
+			{
+				Trigger->TimingError = (int32_t)(Trigger->LandTime - Trigger->CrossingTime);
+			}
+		}
+		if ( Trigger->Fired || Trigger->Missed )
+		{
+			continue;
+		}
+		if (Trigger->Crossed)
+		{
+			Trigger->PredictedTime = Trigger->CrossingTime;
+			Trigger->Predicted = true;
+		}
+		else if ( (Distance != 0.0) && ((ToLast * Distance) > 0.0) && TriggerReachable(Trigger) )
+		{
+			Trigger->PredictedTime = SampleLast.Time + (uint32_t)(Duration * ToLast / Distance);
+			Trigger->Predicted = true;
+		}
+		else
+		{
+			Trigger->Predicted = false;
+		}
+	}
+}
+
+float SMC100::ProfileExpectedPosition(uint32_t Elapsed)
+{
+	if ( (Elapsed >= ProfileActive.Time) || (ProfileActive.Time <= ProfilePrevious.Time) )
+	{
+		return ProfileActive.Position;
+	}
+	if (Elapsed <= ProfilePrevious.Time)
+	{
+		return ProfilePrevious.Position;
+	}
+	float Fraction = (float)(Elapsed - ProfilePrevious.Time) / (float)(ProfileActive.Time - ProfilePrevious.Time);
+	return ProfilePrevious.Position + Fraction * (ProfileActive.Position - ProfilePrevious.Position);
+}
+
+void SMC100::ProfileTrackPosition()
+{
+	//The sample is taken as half way through the TP round trip.
+	uint32_t SampleTime = TransmitTime + (micros() - TransmitTime) / 2;
+	TrackingError = Position - ProfileExpectedPosition(SampleTime - ProfileStartTime);
+	if (fabs(TrackingError) > TrackingErrorMax)
+	{
+		TrackingErrorMax = fabs(TrackingError);
+	}
+}
+
+void SMC100::CheckWaitAfterSending()
+{
+	if ( (micros() - TransmitTime) > WaitAfterSendingTime )
+	{
+		if (CurrentCommandSkipFollowUp)
+		{
+			//No TE follows straight away, so a later one would not time this set.
+			FollowUpFor = CommandType::None;
+			TriggerLanding = -1;
+			Mode = ModeType::Idle;
+		}
+		else
+		{
+			SendErrorCommandRequest();
+		}
+	}
+}
+
+void SMC100::CheckForCommandReply()
+{
+	//Everything already received is read up to the end of a line, so a slow loop cannot turn a reply into a time out.
+	while (SerialPort->available())
+	{
+		char NewChar = SerialPort->read();
+		if (Recorder != NULL)
+		{
+			Recorder->Record(micros(), Address, SMC100Recorder::DirectionType::Receive, NewChar);
+		}
+		if (NewChar == CarriageReturnCharacter)
+		{
+
+		}
+		else if (NewChar == NewLineCharacter)
+		{
+			ReplyBuffer[ReplyBufferIndex] = '\0';
+			ParseReply();
+			ReplyBufferIndex = 0;
+			return;
+		}
+		else if (ReplyBufferIndex < (SMC100ReplyBufferSize - 1))
+		{
+			ReplyBuffer[ReplyBufferIndex] = NewChar;
+			ReplyBufferIndex++;
+		}
+		else
+		{
+			ReplyBuffer[SMC100ReplyBufferSize-1] = '\0';
+			ReplyError(&ErrorCounts.BufferOverflow);
+			if (Verbose)
+			{
+				Serial.print("<SMC100>(Error: Buffer overflow with ");
+				Serial.print(ReplyBuffer);
+				Serial.print(")\n");
+			}
+			ReplyBufferIndex = 0;
+			Mode = ModeType::Idle;
+			return;
+		}
+	}
+	if ( (Mode == ModeType::WaitForCommandReply) && ((micros() - TransmitTime) > CommandReplyTime) )
+	{
+		uint8_t Type = static_cast<uint8_t>(CurrentCommand->Command);
+		Turnaround[Type] = min((uint32_t)Turnaround[Type] * 2, (uint32_t)TurnaroundMax);
+		ReplyError(&ErrorCounts.Timeout);
+		ReplyBufferIndex = 0;
+		FollowUpFor = CommandType::None;
+		TriggerLanding = -1;
+		Mode = ModeType::Idle;
+		if (Verbose)
+		{
+			Serial.print("<SMC100>(Time out detected.)\n");
+		}
+	}
+}
+
+void SMC100::ParseReply()
+{
+	char* EndOfAddress;
+	char* ParameterAddress;
+	uint8_t AddressOfReply = strtol(ReplyBuffer, &EndOfAddress, 10);
+	if (AddressOfReply != Address)
+	{
+		ReplyError(&ErrorCounts.AddressMismatch);
+		if (Verbose)
+		{
+			Serial.print("<SMC100>(Address does not match return for ");
+			Serial.print(ReplyBuffer);
+			Serial.print(")\n");
+		}
+	}
+	else if ( (CurrentCommand->CommandChar[0] != *EndOfAddress) || (CurrentCommand->CommandChar[1] != *(EndOfAddress + 1)) )
+	{
+		ReplyError(&ErrorCounts.CommandMismatch);
+		if (Verbose)
+		{
+			Serial.print("<SMC100>(Return string expected ");
+			Serial.print(CurrentCommand->CommandChar[0]);
+			Serial.print(CurrentCommand->CommandChar[1]);
+			Serial.print(" but received ");
+			Serial.print(*EndOfAddress);
+			Serial.print(*(EndOfAddress + 1));
+			Serial.print(")\n");
+		}
+	}
+	else
+	{
+		ParameterAddress = EndOfAddress + 2;
+		//Only a reply that matched the command measures its turnaround, foreign and stale lines would skew it.
+		UpdateTurnaround(ReplyBufferIndex + 2);
+		ReplySynchronised();
+		//char* EndOfReplyData = ReplyData + ReplyBufferIndex;
+		if (CurrentCommand->Command == CommandType::PositionReal)
+		{
+			Position = atof(ParameterAddress);
+			if ( ProfileReadingPosition && ((int32_t)(TransmitTime - ProfileStartTime) >= 0) )
+			{
+				ProfileReadingPosition = false;
+				if (!ProfileReadingVelocity)
+				{
+					ProfileStartTime = micros();
+				}
+				ProfilePrevious.Position = Position;
+				ProfileActive = ProfilePrevious;
+			}
+			else if (ProfileRunning)
+			{
+				ProfileTrackPosition();
+			}
+			if (TriggerCount > 0)
+			{
+				TriggerTrackPosition();
+			}
+			if ( NeedToFireMoveComplete && (Status != StatusType::Moving) )
+			{
+				NeedToFireMoveComplete = false;
+				if (MoveCompleteCallback != NULL)
+				{
+					MoveCompleteCallback();
+				}
+			}
+			if (NeedToFireHomeComplete)
+			{
+				NeedToFireHomeComplete = false;
+				if (HomeCompleteCallback != NULL)
+				{
+					HomeCompleteCallback();
+				}
+			}
+			Mode = ModeType::Idle;
+		}
+		else if (CurrentCommand->Command == CommandType::ErrorCommands)
+		{
+			if (ProfileCheckingErrors)
+			{
+				ProfileErrorsChecked = true;
+			}
+			if (*ParameterAddress != NoErrorCharacter)
+			{
+				if (ProfileRunning)
+				{
+					ProfileFailed = true;
+				}
+				ReplyError(&ErrorCounts.CommandError);
+				if (Verbose)
+				{
+					Serial.print("<SMC100>(Error code: ");
+					Serial.print(*ParameterAddress);
+					Serial.print(")\n");
+				}
+			}
+			//Status is refreshed either way, a rejected command can leave it different from what was expected.
+			SendErrorHardwareRequest();
+		}
+		else if (CurrentCommand->Command == CommandType::ErrorHardware)
+		{
+			if (Starting)
+			{
+				Starting = false;
+				StartupTime = micros() - BeginTime;
+			}
+			if (strlen(ParameterAddress) < 6)
+			{
+				ReplyError(&ErrorCounts.Malformed);
+				Mode = ModeType::Idle;
+				return;
+			}
+			bool ErrorStatus = false;
+			char ErrorCode[5];
 			for (uint8_t Index = 0; Index < 4; Index++)
 			{
 				ErrorCode[Index] = *(ParameterAddress + Index);
@@ -402,11 +1388,15 @@ void SMC100::ParseReply()
 					ErrorStatus = true;
 				}
 			}
+			ErrorCode[4] = '\0';
 			if (ErrorStatus)
 			{
-				Serial.print("<SMC100>(Error hardware code: ");
-				Serial.print(ErrorCode);
-				Serial.print(")\n");
+				if (Verbose)
+				{
+					Serial.print("<SMC100>(Error hardware code: ");
+					Serial.print(ErrorCode);
+					Serial.print(")\n");
+				}
 				Mode = ModeType::Idle;
 			}
 			char StatusChar[3];
@@ -414,11 +1404,16 @@ void SMC100::ParseReply()
 			StatusChar[1] = *(ParameterAddress + 5);
 			StatusChar[2] = '\0';
 			Status = ConvertStatus(StatusChar);
+			StatusCount++;
 			if (Status == StatusType::Error)
 			{
-				Serial.print("<SMC100>(Error status code not recognized: ");
-				Serial.print(StatusChar);
-				Serial.print(")\n");
+				ReplyError(&ErrorCounts.StatusUnknown);
+				if (Verbose)
+				{
+					Serial.print("<SMC100>(Error status code not recognized: ");
+					Serial.print(StatusChar);
+					Serial.print(")\n");
+				}
 				Mode = ModeType::Idle;
 			}
 			else if ( Status == StatusType::NoReference )
@@ -429,23 +1424,49 @@ void SMC100::ParseReply()
 			else if ( Status == StatusType::Homing )
 			{
 				HasBeenHomed = false;
-				SendErrorHardwareRequest();
+				if (ContinuousPolling)
+				{
+					SendErrorHardwareRequest();
+				}
+				else
+				{
+					Mode = ModeType::Idle;
+				}
 			}
 			else if ( Status == StatusType::Moving )
 			{
 				HasBeenHomed = true;
-				SendErrorHardwareRequest();
+				if (TriggersArmed())
+				{
+					TriggerMotionSeen = true;
+				}
+				if (SampleMotion())
+				{
+					SendPositionRequest();
+				}
+				else if (ContinuousPolling)
+				{
+					SendErrorHardwareRequest();
+				}
+				else
+				{
+					Mode = ModeType::Idle;
+				}
 			}
 			else if ( Status == StatusType::Ready )
 			{
 				HasBeenHomed = true;
 				SendPositionRequest();
 			}
+			else
+			{
+				Mode = ModeType::Idle;
+			}
 		}
 		else if (CurrentCommand->Command == CommandType::GPIOInput)
 		{
 			GPIOInput = (uint8_t)atoi(ParameterAddress);
-			SendErrorCommandRequest();
+			QueryComplete();
 			if (GPIOReturnCallback != NULL)
 			{
 				GPIOReturnCallback();
@@ -461,7 +1482,9 @@ void SMC100::ParseReply()
 			if (CurrentCommandGetOrSet == CommandGetSetType::Get)
 			{
 				PositionLimitNegative = atof(ParameterAddress);
-				SendErrorCommandRequest();
+				LimitNegativeValid = true;
+				ConfigurationReceived(CommandType::LimitNegative, PositionLimitNegative);
+				LimitsReceived();
 			}
 			else
 			{
@@ -473,13 +1496,41 @@ void SMC100::ParseReply()
 			if (CurrentCommandGetOrSet == CommandGetSetType::Get)
 			{
 				PositionLimitPositive = atof(ParameterAddress);
-				SendErrorCommandRequest();
+				LimitPositiveValid = true;
+				ConfigurationReceived(CommandType::LimitPositive, PositionLimitPositive);
+				LimitsReceived();
 			}
 			else
 			{
 				SendGetLimitPositive();
 			}
 		}
+		else if ( (CurrentCommand->Command == CommandType::Velocity) || (CurrentCommand->Command == CommandType::Acceleration) || (CurrentCommand->Command == CommandType::Backlash) || (CurrentCommand->Command == CommandType::JerkTime) )
+		{
+			if (CurrentCommandGetOrSet == CommandGetSetType::Get)
+			{
+				ConfigurationReceived(CurrentCommand->Command, atof(ParameterAddress));
+				if ( (CurrentCommand->Command == CommandType::Velocity) && ProfileReadingVelocity )
+				{
+					ProfileVelocitySaved = atof(ParameterAddress);
+					ProfileVelocitySavedValid = true;
+					ProfileReadingVelocity = false;
+					if (!ProfileReadingPosition)
+					{
+						ProfileStartTime = micros();
+					}
+					Mode = ModeType::Idle;
+				}
+				else
+				{
+					QueryComplete();
+				}
+			}
+			else
+			{
+				SendErrorCommandRequest();
+			}
+		}
 		else
 		{
 			SendErrorCommandRequest();
@@ -487,6 +1538,110 @@ void SMC100::ParseReply()
 	}
 }
 
+void SMC100::ReplyError(uint32_t* Counter)
+{
+	(*Counter)++;
+	if (ConfigurationStage == ConfigurationStageType::Writing)
+	{
+		//Any reply lost or rejected while writing means a parameter may not have been stored.
+		ConfigurationFailed = true;
+	}
+	if (!OutOfSync)
+	{
+		OutOfSync = true;
+		OutOfSyncTime = micros();
+	}
+}
+
+void SMC100::ReplySynchronised()
+{
+	//Time from the first error to the next reply that matched the command, binned by powers of two milliseconds.
+	ErrorCounts.Replies++;
+	if (!OutOfSync)
+	{
+		return;
+	}
+	OutOfSync = false;
+	uint32_t ResyncTime = micros() - OutOfSyncTime;
+	if (ResyncTime > ErrorCounts.ResyncTimeMax)
+	{
+		ErrorCounts.ResyncTimeMax = ResyncTime;
+	}
+	uint8_t Bin = 0;
+	for (uint32_t Milliseconds = ResyncTime / 1000; (Milliseconds > 0) && (Bin < (SMC100ResyncBins - 1)); Milliseconds >>= 1)
+	{
+		Bin++;
+	}
+	ErrorCounts.ResyncHistogram[Bin]++;
+}
+
+void SMC100::LimitsReceived()
+{
+	if (AreLimitsValid())
+	{
+		SaveConfigurationCache();
+	}
+	else
+	{
+		//The other limit is asked for straight away rather than after the retry interval.
+		LimitQueryTime = micros() - LimitQueryEvery;
+	}
+	QueryComplete();
+}
+
+bool SMC100::LoadConfigurationCache()
+{
+#if SMC100UseEEPROMCache
+	if (ConfigurationCacheAddress < 0)
+	{
+		return false;
+	}
+	ConfigurationCacheStruct Cache;
+	EEPROM.get(ConfigurationCacheAddress, Cache);
+	if ( (Cache.Version != SMC100CacheVersion) || (Cache.Address != Address) || (Cache.Checksum != ConfigurationCacheChecksum(&Cache)) )
+	{
+		return false;
+	}
+	PositionLimitNegative = Cache.PositionLimitNegative;
+	PositionLimitPositive = Cache.PositionLimitPositive;
+	LimitNegativeValid = true;
+	LimitPositiveValid = true;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void SMC100::SaveConfigurationCache()
+{
+#if SMC100UseEEPROMCache
+	if (ConfigurationCacheAddress < 0)
+	{
+		return;
+	}
+	ConfigurationCacheStruct Cache;
+	memset(&Cache, 0, sizeof(Cache));
+	Cache.Version = SMC100CacheVersion;
+	Cache.Address = Address;
+	Cache.PositionLimitNegative = PositionLimitNegative;
+	Cache.PositionLimitPositive = PositionLimitPositive;
+	Cache.Checksum = ConfigurationCacheChecksum(&Cache);
+	EEPROM.put(ConfigurationCacheAddress, Cache);
+#endif
+}
+
+uint8_t SMC100::ConfigurationCacheChecksum(const ConfigurationCacheStruct* Cache)
+{
+	const uint8_t* Bytes = reinterpret_cast<const uint8_t*>(Cache);
+	const uint8_t* BytesEnd = &(Cache->Checksum);
+	uint8_t Checksum = 0xA5;
+	for (uint8_t Index = 0; (Bytes + Index) < BytesEnd; ++Index)
+	{
+		Checksum = (Checksum << 1 | Checksum >> 7) ^ Bytes[Index];
+	}
+	return Checksum;
+}
+
 SMC100::StatusType SMC100::ConvertStatus(char* StatusChar)
 {
 	for (int Index = 0; Index < 21; ++Index)
@@ -511,25 +1666,27 @@ bool SMC100::SendCurrentCommand()
 	//Serial.print(Address);
 	//Serial.print(CurrentCommand->CommandChar[0]);
 	//Serial.print(CurrentCommand->CommandChar[1]);
-	SerialPort->print(Address);
-	SerialPort->write(CurrentCommand->CommandChar[0]);
-	SerialPort->write(CurrentCommand->CommandChar[1]);
+	CurrentCommandSkipFollowUp = false;
+	TransmitFrame.Clear();
+	TransmitFrame.print(Address);
+	TransmitFrame.write(CurrentCommand->CommandChar[0]);
+	TransmitFrame.write(CurrentCommand->CommandChar[1]);
 	if (CurrentCommandGetOrSet == CommandGetSetType::Get)
 	{
 		//Serial.write(GetCharacter);
-		SerialPort->write(GetCharacter);
+		TransmitFrame.write(GetCharacter);
 	}
 	else if (CurrentCommandGetOrSet == CommandGetSetType::Set)
 	{
 		if (CurrentCommand->SendType == CommandParameterType::Int)
 		{
 			//Serial.print((int)(CurrentCommandParameter));
-			SerialPort->print((int)(CurrentCommandParameter));
+			TransmitFrame.print((int)(CurrentCommandParameter));
 		}
 		else if (CurrentCommand->SendType == CommandParameterType::Float)
 		{
 			//Serial.print(CurrentCommandParameter,6);
-			SerialPort->print(CurrentCommandParameter,6);
+			TransmitFrame.print(CurrentCommandParameter,6);
 		}
 		else
 		{
@@ -545,23 +1702,33 @@ bool SMC100::SendCurrentCommand()
 		Status = false;
 	}
 	//Serial.print(NewLineCharacter);
-	SerialPort->write(CarriageReturnCharacter);
-	SerialPort->write(NewLineCharacter);
+	TransmitFrame.write(CarriageReturnCharacter);
+	TransmitFrame.write(NewLineCharacter);
+	SerialPort->write(TransmitFrame.Data, TransmitFrame.Length);
 	ReplyBufferIndex = 0;
 	TransmitTime = micros();
+	if (Recorder != NULL)
+	{
+		Recorder->RecordFrame(TransmitTime, Address, TransmitFrame.Data, TransmitFrame.Length);
+	}
+	CalculateCommandTiming(TransmitFrame.Length);
 	if ( (CurrentCommand->Command == CommandType::MoveAbs) || (CurrentCommand->Command == CommandType::MoveRel) )
 	{
-		if (CurrentCommandGetOrSet == CommandGetSetType::Set)
+		if ( (CurrentCommandGetOrSet == CommandGetSetType::Set) && !ProfileRunning )
 		{
 			NeedToFireMoveComplete = true;
 		}
-	}
-	if ( (CurrentCommand->Command == CommandType::Home) )
-	{
 		if (CurrentCommandGetOrSet == CommandGetSetType::Set)
 		{
-			NeedToFireHomeComplete = true;
+			MoveTarget = CurrentCommandParameter;
+			MoveTargetValid = (CurrentCommand->Command == CommandType::MoveAbs);
 		}
+		SampleCount = 0;
+	}
+	if ( (CurrentCommand->Command == CommandType::Home) )
+	{
+		NeedToFireHomeComplete = true;
+		MoveTargetValid = false;
 	}
 	if ( (CurrentCommandGetOrSet == CommandGetSetType::Get) || (CurrentCommand->GetSetType == CommandGetSetType::GetAlways) )
 	{
@@ -574,6 +1741,107 @@ bool SMC100::SendCurrentCommand()
 	return Status;
 }
 
+uint32_t SMC100::SerialTime(uint8_t Bytes)
+{
+	return (uint32_t)Bytes * ByteTime;
+}
+
+void SMC100::CalculateCommandTiming(uint8_t FrameBytes)
+{
+	//Reply allowance covers the frame out, the longest reply back and a multiple of the learned turnaround.
+	uint32_t CommandTurnaround = Turnaround[static_cast<uint8_t>(CurrentCommand->Command)];
+	TransmitBytes = FrameBytes;
+	CommandReplyTime = SerialTime(FrameBytes) + SerialTime(SMC100ReplyBufferSize) + CommandReplyTimeFactor * CommandTurnaround;
+	CommandReplyTime = constrain(CommandReplyTime, CommandReplyTimeMin, CommandReplyTimeMax);
+	//A set has no reply, TE follows as soon as the frame is out and its reply times the set instead.
+	WaitAfterSendingTime = SerialTime(FrameBytes) + TurnaroundMin;
+	bool Replies = ( (CurrentCommandGetOrSet == CommandGetSetType::Get) || (CurrentCommand->GetSetType == CommandGetSetType::GetAlways) );
+	if (!Replies)
+	{
+		TriggerLanding = -1;
+		FollowUpFor = CurrentCommand->Command;
+		FollowUpTransmitTime = TransmitTime;
+		FollowUpBytes = FrameBytes;
+	}
+	else if (CurrentCommand->Command != CommandType::ErrorCommands)
+	{
+		FollowUpFor = CommandType::None;
+	}
+	if (CurrentCommand->Command == CommandType::Reset)
+	{
+		WaitAfterSendingTime = ResetTime;
+		FollowUpFor = CommandType::None;
+	}
+	else if ( (CurrentCommand->Command == CommandType::Configure) && (CurrentCommandGetOrSet == CommandGetSetType::Set) && (CurrentCommandParameter == 0.0) )
+	{
+		WaitAfterSendingTime = ConfigurationSaveTime;
+		FollowUpFor = CommandType::None;
+	}
+}
+
+void SMC100::UpdateTurnaround(uint8_t ReplyBytes)
+{
+	//A TE straight after a set waits in the controller until the set is done, so its reply times the set.
+	uint32_t Now = micros();
+	if ( (CurrentCommand->Command == CommandType::ErrorCommands) && (FollowUpFor != CommandType::None) )
+	{
+		uint32_t SetOverhead = SerialTime(FollowUpBytes) + SerialTime(TransmitBytes) + SerialTime(ReplyBytes) + Turnaround[static_cast<uint8_t>(CommandType::ErrorHardware)];
+		uint32_t SetTurnaround = LearnTurnaround(FollowUpFor, Now - FollowUpTransmitTime, SetOverhead);
+		if ( (FollowUpFor == CommandType::GPIOOutput) && (TriggerLanding >= 0) )
+		{
+			//The trigger's SB took effect once its frame was in and the controller had turned it round.
+			TriggerStruct* Trigger = &Triggers[TriggerLanding];
+			Trigger->LandTime = FollowUpTransmitTime + SerialTime(FollowUpBytes) + SetTurnaround;
+			Trigger->LandMeasured = true;
+			if (Trigger->Crossed)
+			{
+				Trigger->TimingError = (int32_t)(Trigger->LandTime - Trigger->CrossingTime);
+			}
+		}
+		TriggerLanding = -1;
+		FollowUpFor = CommandType::None;
+		return;
+	}
+	LearnTurnaround(CurrentCommand->Command, Now - TransmitTime, SerialTime(TransmitBytes) + SerialTime(ReplyBytes));
+}
+
+uint32_t SMC100::LearnTurnaround(CommandType Type, uint32_t RoundTrip, uint32_t SerialOverhead)
+{
+	//Exponentially weighted average of the time the controller spent between our frame and its reply.
+	int32_t Measured = 0;
+	if (RoundTrip > SerialOverhead)
+	{
+		Measured = RoundTrip - SerialOverhead;
+	}
+	Measured = constrain(Measured, (int32_t)TurnaroundMin, (int32_t)TurnaroundMax);
+	uint8_t Index = static_cast<uint8_t>(Type);
+	int32_t Estimate = Turnaround[Index];
+	Estimate += (Measured - Estimate) >> TurnaroundFilterShift;
+	Turnaround[Index] = constrain(Estimate, (int32_t)TurnaroundMin, (int32_t)TurnaroundMax);
+	return Measured;
+}
+
+SMC100::FrameBuffer::FrameBuffer()
+{
+	Clear();
+}
+
+void SMC100::FrameBuffer::Clear()
+{
+	Length = 0;
+}
+
+size_t SMC100::FrameBuffer::write(uint8_t NewByte)
+{
+	if (Length >= SMC100TransmitBufferSize)
+	{
+		return 0;
+	}
+	Data[Length] = NewByte;
+	Length++;
+	return 1;
+}
+
 void SMC100::ClearCommandQueue()
 {
 	for (int Index = 0; Index < SMC100QueueCount; ++Index)
@@ -2,9 +2,33 @@
 #define SMC100_h
 
 #include "Arduino.h"
+#include "SMC100Recorder.h"
 
-#define SMC100QueueCount 8
+#define SMC100QueueCount 12
 #define SMC100ReplyBufferSize 32
+#define SMC100TransmitBufferSize 24
+#define SMC100CacheVersion 1
+#define SMC100CommandTypeCount 22
+#define SMC100DefaultBaudRate 57600
+#define SMC100ProfileCount 8
+#define SMC100ResyncBins 8
+#define SMC100ConfigurationCount 6
+#define SMC100TriggerCount 8
+//The limit cache needs EEPROM.h, which Arduino only puts on the include path when the sketch itself includes <EEPROM.h>.
+//Without it SetConfigurationCache() returns false and every boot reads the limits from the controller.
+#ifndef SMC100UseEEPROMCache
+#if defined(__has_include)
+#if __has_include(<EEPROM.h>)
+#define SMC100UseEEPROMCache 1
+#else
+#define SMC100UseEEPROMCache 0
+#endif
+#else
+#define SMC100UseEEPROMCache 0
+#endif
+#endif
+
+class SMC100Bus;
 
 class SMC100
 {
@@ -30,6 +54,10 @@ class SMC100
 			KeypadEnable,
 			ErrorCommands,
 			ErrorHardware,
+			Velocity,
+			Acceleration,
+			Backlash,
+			JerkTime,
 		};
 		enum class CommandParameterType : uint8_t
 		{
@@ -58,6 +86,12 @@ class SMC100
 			GetSet,
 			GetAlways,
 		};
+		enum class ConfigurationStageType : uint8_t
+		{
+			None,
+			Reading,
+			Writing,
+		};
 		enum class ModeType : uint8_t
 		{
 			Inactive,
@@ -83,15 +117,88 @@ class SMC100
 			const char* Code;
 			StatusType Type;
 		};
-		SMC100(HardwareSerial* serial, uint8_t address);
+		struct ProfilePointStruct
+		{
+			uint32_t Time;
+			float Position;
+			float Velocity;
+		};
+		struct TriggerStruct
+		{
+			float Position;
+			uint8_t Output;
+			bool Predicted;
+			bool Fired;
+			bool Crossed;
+			bool Missed;
+			uint32_t PredictedTime;
+			uint32_t LandTime;
+			bool LandMeasured;
+			uint32_t CrossingTime;
+			int32_t TimingError;
+		};
+		struct SampleStruct
+		{
+			uint32_t Time;
+			float Position;
+		};
+		struct ConfigurationStruct
+		{
+			float Velocity;
+			float Acceleration;
+			float LimitNegative;
+			float LimitPositive;
+			float Backlash;
+			float JerkTime;
+		};
+		struct ErrorCountStruct
+		{
+			uint32_t Replies;
+			uint32_t AddressMismatch;
+			uint32_t CommandMismatch;
+			uint32_t BufferOverflow;
+			uint32_t Timeout;
+			uint32_t StatusUnknown;
+			uint32_t Malformed;
+			uint32_t CommandError;
+			uint32_t ResyncTimeMax;
+			uint32_t ResyncHistogram[SMC100ResyncBins];
+		};
+		struct ConfigurationCacheStruct
+		{
+			uint8_t Version;
+			uint8_t Address;
+			float PositionLimitNegative;
+			float PositionLimitPositive;
+			uint8_t Checksum;
+		};
+		SMC100(Stream* serial, uint8_t address);
+		SMC100(SMC100Bus* bus, uint8_t address);
+		static uint32_t ScanBus(Stream* serial, uint8_t FirstAddress, uint8_t LastAddress);
 		void Check();
 		void Begin();
+		bool SetConfigurationCache(int EEPROMAddress);
+		void SetBaudRate(uint32_t BaudRate);
+		void SetRecorder(SMC100Recorder* NewRecorder);
+		void SetVerbose(bool Setting);
+		const ErrorCountStruct* GetErrorCounts();
+		void ClearErrorCounts();
+		uint32_t GetCommandTurnaround(CommandType Type);
+		uint32_t GetCommandLatency(CommandType Type);
+		bool AreLimitsValid();
+		bool IsStarting();
+		uint32_t GetStartupTime();
 		bool IsHomed();
 		bool IsReady();
 		bool IsMoving();
 		bool IsEnabled();
+		StatusType GetStatus();
+		uint32_t GetStatusCount();
+		void SendGetStatus();
+		void SetContinuousPolling(bool Setting);
 		void Enable(bool Setting);
 		bool IsBusy();
+		bool IsQueueFull();
 		void Home();
 		void MoveAbsolute(float Target);
 		void SetGPIOOutput(uint8_t Pin, bool Output);
@@ -102,8 +209,37 @@ class SMC100
 		void SetHomeCompleteCallback(FinishedListener Callback);
 		void SetMoveCompleteCallback(FinishedListener Callback);
 		void SetGPIOReturnCallback(FinishedListener Callback);
+		void SetProfileCompleteCallback(FinishedListener Callback);
+		void SetConfigurationCompleteCallback(FinishedListener Callback);
+		void ApplyConfiguration(const ConfigurationStruct* Configuration);
+		bool IsConfiguring();
+		uint8_t GetConfigurationChanges();
+		bool IsConfigurationFailed();
+		const ConfigurationStruct* GetConfiguration();
 		float GetPosition();
+		bool ProfilePut(uint32_t Time, float Position, float Velocity = 0.0);
+		uint8_t ProfileSpace();
+		void ProfileStart();
+		void ProfileStop();
+		bool IsProfileRunning();
+		bool IsProfileFailed();
+		bool AddPositionTrigger(float Position, uint8_t Output);
+		void ClearPositionTriggers();
+		uint8_t GetPositionTriggerCount();
+		const TriggerStruct* GetPositionTrigger(uint8_t Index);
+		float GetTrackingError();
+		float GetTrackingErrorMax();
 	private:
+		class FrameBuffer : public Print
+		{
+			public:
+				FrameBuffer();
+				void Clear();
+				size_t write(uint8_t NewByte);
+				using Print::write;
+				uint8_t Data[SMC100TransmitBufferSize];
+				uint8_t Length;
+		};
 		void CheckCommandQueue();
 		void CheckForCommandReply();
 		void CheckWaitAfterSending();
@@ -123,29 +259,76 @@ class SMC100
 		void SendErrorCommandRequest();
 		void SendErrorHardwareRequest();
 		void SendPositionRequest();
+		void CheckConfiguration();
+		float* ConfigurationField(ConfigurationStruct* Configuration, CommandType Type);
+		void ConfigurationReceived(CommandType Type, float Value);
+		void QueryComplete();
+		void CheckProfile();
+		void SendProfileSetpoint(CommandType Type, float Parameter);
+		void ProfileRestoreVelocity();
+		float ClampToLimits(float Target);
+		float ProfileExpectedPosition(uint32_t Elapsed);
+		bool SampleMotion();
+		bool TriggersArmed();
+		bool CheckTriggers();
+		bool TriggerReachable(const TriggerStruct* Trigger);
+		void TriggerTrackPosition();
+		void ExpireTriggers();
+		void ProfileTrackPosition();
+		void ReplyError(uint32_t* Counter);
+		void ReplySynchronised();
+		void LimitsReceived();
+		void CheckLimits(bool MoveHeld);
+		bool MoveAtQueueHead();
+		bool LoadConfigurationCache();
+		void SaveConfigurationCache();
+		static uint8_t ConfigurationCacheChecksum(const ConfigurationCacheStruct* Cache);
+		uint32_t SerialTime(uint8_t Bytes);
+		void UpdateTurnaround(uint8_t ReplyBytes);
+		uint32_t LearnTurnaround(CommandType Type, uint32_t RoundTrip, uint32_t SerialOverhead);
+		void CalculateCommandTiming(uint8_t FrameBytes);
 		StatusType ConvertStatus(char* StatusChar);
 		void ParseReply();
 		static const CommandStruct CommandLibrary[];
 		static const StatusCharSet StatusLibrary[];
+		static const CommandType ConfigurationCommands[];
 		static const uint32_t CommandReplyTimeMax;
+		static const uint32_t CommandReplyTimeMin;
+		static const uint8_t CommandReplyTimeFactor;
+		static const uint16_t TurnaroundDefault;
+		static const uint16_t TurnaroundMin;
+		static const uint16_t TurnaroundMax;
+		static const uint8_t TurnaroundFilterShift;
+		static const uint8_t BitsPerSerialByte;
+		static const uint8_t TypicalFrameBytes;
+		static const uint32_t ResetTime;
+		static const uint32_t ConfigurationSaveTime;
+		static const float ConfigurationTolerance;
 		static const uint32_t WipeInputEvery;
+		static const uint32_t LimitQueryEvery;
 		static const char CarriageReturnCharacter;
 		static const char NewLineCharacter;
 		static const char GetCharacter;
 		static const uint32_t WaitAfterSendingTimeMax;
 		static const char NoErrorCharacter;
+		static const uint32_t ScanReplyTimeMax;
+		static const uint8_t AddressMax;
 		ModeType Mode;
 		StatusType Status;
+		uint32_t StatusCount;
 		bool Busy;
 		bool HasBeenHomed;
 		float Position;
-		HardwareSerial* SerialPort;
+		Stream* SerialPort;
+		SMC100Bus* Bus;
 		FinishedListener AllCompleteCallback;
 		FinishedListener MoveCompleteCallback;
 		bool NeedToFireMoveComplete;
 		FinishedListener HomeCompleteCallback;
 		FinishedListener GPIOReturnCallback;
 		bool NeedToFireHomeComplete;
+		FinishedListener ProfileCompleteCallback;
+		FinishedListener ConfigurationCompleteCallback;
 		const CommandStruct* CurrentCommand;
 		CommandGetSetType CurrentCommandGetOrSet;
 		float CurrentCommandParameter;
@@ -154,14 +337,71 @@ class SMC100
 		float AnalogueReading;
 		float PositionLimitNegative;
 		float PositionLimitPositive;
+		bool LimitNegativeValid;
+		bool LimitPositiveValid;
+		uint32_t LimitQueryTime;
+		bool Starting;
+		uint32_t BeginTime;
+		uint32_t StartupTime;
+		int ConfigurationCacheAddress;
 		uint8_t Address;
 		uint32_t LastWipeTime;
 		uint32_t TransmitTime;
+		FrameBuffer TransmitFrame;
+		SMC100Recorder* Recorder;
+		bool Verbose;
+		bool ContinuousPolling;
+		ErrorCountStruct ErrorCounts;
+		bool OutOfSync;
+		uint32_t OutOfSyncTime;
+		uint32_t ByteTime;
+		uint8_t TransmitBytes;
+		CommandType FollowUpFor;
+		uint32_t FollowUpTransmitTime;
+		uint8_t FollowUpBytes;
+		uint32_t CommandReplyTime;
+		uint32_t WaitAfterSendingTime;
+		uint16_t Turnaround[SMC100CommandTypeCount];
 		uint8_t ReplyBufferIndex;
 		char ReplyBuffer[SMC100ReplyBufferSize];
 		CommandQueueEntry CommandQueue[SMC100QueueCount];
 		uint8_t CommandQueueHead;
 		uint8_t CommandQueueTail;
 		bool CommandQueueFullFlag;
+		ProfilePointStruct Profile[SMC100ProfileCount];
+		uint8_t ProfileTail;
+		uint8_t ProfileCount;
+		bool ProfileRunning;
+		uint32_t ProfileStartTime;
+		ProfilePointStruct ProfilePrevious;
+		ProfilePointStruct ProfileActive;
+		float ProfileVelocity;
+		float ProfileVelocitySaved;
+		bool ProfileVelocitySavedValid;
+		bool ProfileReadingVelocity;
+		bool ProfileReadingPosition;
+		bool ProfileCheckingErrors;
+		bool ProfileErrorsChecked;
+		bool ProfileFailed;
+		bool ProfileMovePending;
+		float ProfileMoveTarget;
+		bool CurrentCommandSkipFollowUp;
+		float TrackingError;
+		float TrackingErrorMax;
+		TriggerStruct Triggers[SMC100TriggerCount];
+		uint8_t TriggerCount;
+		bool TriggerMotionSeen;
+		int8_t TriggerLanding;
+		float MoveTarget;
+		bool MoveTargetValid;
+		SampleStruct SamplePrevious;
+		SampleStruct SampleLast;
+		uint8_t SampleCount;
+		ConfigurationStageType ConfigurationStage;
+		uint8_t ConfigurationReadMask;
+		uint8_t ConfigurationChanges;
+		bool ConfigurationFailed;
+		ConfigurationStruct CurrentConfiguration;
+		ConfigurationStruct TargetConfiguration;
 };
 #endif
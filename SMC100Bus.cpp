@@ -0,0 +1,88 @@
+#include "SMC100Bus.h"
+
+const uint32_t SMC100Bus::WipeInputEvery = 100000;
+
+SMC100Bus::SMC100Bus(Stream* serial)
+{
+	SerialPort = serial;
+	AxisCount = 0;
+	CheckIndex = 0;
+	Owner = NULL;
+	LastWipeTime = 0;
+}
+
+bool SMC100Bus::Attach(SMC100* Axis)
+{
+	//Called by the SMC100 constructor that takes a bus, each axis is attached once.
+	if (AxisCount >= SMC100BusAxesMax)
+	{
+		return false;
+	}
+	Axes[AxisCount] = Axis;
+	AxisCount++;
+	return true;
+}
+
+void SMC100Bus::Check()
+{
+	//Every axis gets a turn, the first turn rotates so no axis is always first to the free line.
+	for (uint8_t Count = 0; Count < AxisCount; ++Count)
+	{
+		Axes[(CheckIndex + Count) % AxisCount]->Check();
+	}
+	if (AxisCount > 0)
+	{
+		CheckIndex = (CheckIndex + 1) % AxisCount;
+	}
+	if ( (Owner == NULL) && ((micros() - LastWipeTime) > WipeInputEvery) )
+	{
+		//Bytes arriving while no axis holds the line are late replies nobody is waiting for.
+		LastWipeTime = micros();
+		if (SerialPort->available())
+		{
+			SerialPort->read();
+		}
+	}
+}
+
+bool SMC100Bus::Acquire(SMC100* Axis)
+{
+	if ( (Owner != NULL) && (Owner != Axis) )
+	{
+		return false;
+	}
+	Owner = Axis;
+	return true;
+}
+
+void SMC100Bus::Release(SMC100* Axis)
+{
+	if (Owner == Axis)
+	{
+		Owner = NULL;
+	}
+}
+
+bool SMC100Bus::IsHeld()
+{
+	return (Owner != NULL);
+}
+
+Stream* SMC100Bus::GetStream()
+{
+	return SerialPort;
+}
+
+uint8_t SMC100Bus::GetAxisCount()
+{
+	return AxisCount;
+}
+
+SMC100* SMC100Bus::GetAxis(uint8_t Index)
+{
+	if (Index >= AxisCount)
+	{
+		return NULL;
+	}
+	return Axes[Index];
+}
@@ -0,0 +1,30 @@
+#ifndef SMC100Bus_h	//check for multiple inclusions
+#define SMC100Bus_h
+
+#include "Arduino.h"
+#include "SMC100.h"
+
+#define SMC100BusAxesMax 8
+
+class SMC100Bus
+{
+	public:
+		SMC100Bus(Stream* serial);
+		bool Attach(SMC100* Axis);
+		void Check();
+		bool Acquire(SMC100* Axis);
+		void Release(SMC100* Axis);
+		bool IsHeld();
+		Stream* GetStream();
+		uint8_t GetAxisCount();
+		SMC100* GetAxis(uint8_t Index);
+	private:
+		static const uint32_t WipeInputEvery;
+		Stream* SerialPort;
+		SMC100* Axes[SMC100BusAxesMax];
+		uint8_t AxisCount;
+		uint8_t CheckIndex;
+		SMC100* Owner;
+		uint32_t LastWipeTime;
+};
+#endif
@@ -0,0 +1,255 @@
+#include "SMC100Homing.h"
+
+const uint32_t SMC100Homing::PollIntervalDefault = 20000;
+const uint32_t SMC100Homing::TimeoutDefault = 60000000;
+
+SMC100Homing::SMC100Homing()
+{
+	Bus = NULL;
+	AxisCount = 0;
+	StatusRequestedMask = 0;
+	PollIndex = 0;
+	PollInterval = PollIntervalDefault;
+	LastPollTime = 0;
+	Timeout = TimeoutDefault;
+	StartTime = 0;
+	TotalTime = 0;
+	Running = false;
+	CompleteCallback = NULL;
+}
+
+SMC100Homing::SMC100Homing(SMC100Bus* bus) : SMC100Homing()
+{
+	//Check() then drives the axes through the bus, so homing axes never talk over each other.
+	Bus = bus;
+}
+
+int8_t SMC100Homing::AddAxis(SMC100* Axis, uint8_t DependsOn)
+{
+	//Bit n of DependsOn holds this axis back until the axis added n-th has homed.
+	//Only axes added earlier can be depended on, so a self dependency or a cycle cannot wait forever.
+	if ( (AxisCount >= SMC100HomingAxesMax) || ((DependsOn >> AxisCount) != 0) )
+	{
+		return -1;
+	}
+	Axes[AxisCount] = Axis;
+	Dependencies[AxisCount] = DependsOn;
+	States[AxisCount] = AxisStateType::Waiting;
+	StartTimes[AxisCount] = 0;
+	AxisTimes[AxisCount] = 0;
+	RequestTimes[AxisCount] = 0;
+	StatusCounts[AxisCount] = 0;
+	CommandErrors[AxisCount] = 0;
+	AxisCount++;
+	return AxisCount - 1;
+}
+
+void SMC100Homing::SetPollInterval(uint32_t Interval)
+{
+	PollInterval = Interval;
+}
+
+void SMC100Homing::SetTimeout(uint32_t Time)
+{
+	Timeout = Time;
+}
+
+void SMC100Homing::SetCompleteCallback(SMC100::FinishedListener Callback)
+{
+	CompleteCallback = Callback;
+}
+
+void SMC100Homing::Start()
+{
+	StartTime = micros();
+	LastPollTime = StartTime;
+	TotalTime = 0;
+	StatusRequestedMask = 0;
+	PollIndex = 0;
+	for (uint8_t Index = 0; Index < AxisCount; ++Index)
+	{
+		States[Index] = AxisStateType::Waiting;
+		StartTimes[Index] = StartTime;
+		AxisTimes[Index] = 0;
+	}
+	Running = true;
+}
+
+void SMC100Homing::Check()
+{
+	if (Bus != NULL)
+	{
+		Bus->Check();
+	}
+	if (!Running)
+	{
+		return;
+	}
+	bool Pending = false;
+	for (uint8_t Index = 0; Index < AxisCount; ++Index)
+	{
+		if (States[Index] == AxisStateType::Waiting)
+		{
+			if (DependenciesDone(Index))
+			{
+				StartAxis(Index);
+			}
+			else
+			{
+				for (uint8_t Other = 0; Other < AxisCount; ++Other)
+				{
+					if ( bitRead(Dependencies[Index], Other) && (States[Other] == AxisStateType::Failed) )
+					{
+						FinishAxis(Index, AxisStateType::Failed);
+						break;
+					}
+				}
+			}
+		}
+		else if (States[Index] == AxisStateType::Homing)
+		{
+			CheckAxis(Index);
+		}
+		if ( (States[Index] == AxisStateType::Waiting) || (States[Index] == AxisStateType::Homing) )
+		{
+			Pending = true;
+		}
+	}
+	if ( (micros() - LastPollTime) > PollInterval )
+	{
+		LastPollTime = micros();
+		PollNextAxis();
+	}
+	if (!Pending)
+	{
+		Running = false;
+		TotalTime = micros() - StartTime;
+		if (CompleteCallback != NULL)
+		{
+			CompleteCallback();
+		}
+	}
+}
+
+bool SMC100Homing::IsRunning()
+{
+	return Running;
+}
+
+SMC100Homing::AxisStateType SMC100Homing::GetAxisState(uint8_t Index)
+{
+	return States[Index];
+}
+
+uint32_t SMC100Homing::GetAxisTime(uint8_t Index)
+{
+	return AxisTimes[Index];
+}
+
+uint32_t SMC100Homing::GetTotalTime()
+{
+	return TotalTime;
+}
+
+bool SMC100Homing::DependenciesDone(uint8_t Index)
+{
+	for (uint8_t Other = 0; Other < AxisCount; ++Other)
+	{
+		if ( bitRead(Dependencies[Index], Other) && (States[Other] != AxisStateType::Done) )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void SMC100Homing::StartAxis(uint8_t Index)
+{
+	//OR is only accepted when not referenced, so a fresh status decides whether the axis is homed already.
+	SMC100* Axis = Axes[Index];
+	if (!bitRead(StatusRequestedMask, Index))
+	{
+		bitSet(StatusRequestedMask, Index);
+		StartTimes[Index] = micros();
+		RequestStatus(Index);
+		return;
+	}
+	if (!StatusUpdated(Index))
+	{
+		if ( (micros() - StartTimes[Index]) > Timeout )
+		{
+			FinishAxis(Index, AxisStateType::Failed);
+		}
+		else if ( !Axis->IsBusy() && ((micros() - RequestTimes[Index]) > PollInterval) )
+		{
+			RequestStatus(Index);
+		}
+		return;
+	}
+	if ( Axis->IsHomed() && Axis->IsReady() )
+	{
+		FinishAxis(Index, AxisStateType::Done);
+		return;
+	}
+	StatusCounts[Index] = Axis->GetStatusCount();
+	CommandErrors[Index] = Axis->GetErrorCounts()->CommandError;
+	Axis->SetContinuousPolling(false);
+	Axis->Home();
+	States[Index] = AxisStateType::Homing;
+}
+
+void SMC100Homing::CheckAxis(uint8_t Index)
+{
+	//Any status after OR counts, homing can finish between two polls without Homing ever being seen.
+	SMC100* Axis = Axes[Index];
+	if (StatusUpdated(Index))
+	{
+		if ( Axis->IsHomed() && Axis->IsReady() )
+		{
+			FinishAxis(Index, AxisStateType::Done);
+			return;
+		}
+		if ( (Axis->GetErrorCounts()->CommandError != CommandErrors[Index]) && (Axis->GetStatus() != SMC100::StatusType::Homing) )
+		{
+			FinishAxis(Index, AxisStateType::Failed);
+			return;
+		}
+	}
+	if ( (micros() - StartTimes[Index]) > Timeout )
+	{
+		FinishAxis(Index, AxisStateType::Failed);
+	}
+}
+
+void SMC100Homing::RequestStatus(uint8_t Index)
+{
+	StatusCounts[Index] = Axes[Index]->GetStatusCount();
+	RequestTimes[Index] = micros();
+	Axes[Index]->SendGetStatus();
+}
+
+bool SMC100Homing::StatusUpdated(uint8_t Index)
+{
+	return ( !Axes[Index]->IsBusy() && (Axes[Index]->GetStatusCount() != StatusCounts[Index]) );
+}
+
+void SMC100Homing::FinishAxis(uint8_t Index, AxisStateType State)
+{
+	Axes[Index]->SetContinuousPolling(true);
+	AxisTimes[Index] = micros() - StartTimes[Index];
+	States[Index] = State;
+}
+
+void SMC100Homing::PollNextAxis()
+{
+	//One status request per interval, shared round robin over the axes still homing.
+	for (uint8_t Count = 0; Count < AxisCount; ++Count)
+	{
+		PollIndex = (PollIndex + 1) % AxisCount;
+		if ( (States[PollIndex] == AxisStateType::Homing) && !Axes[PollIndex]->IsBusy() )
+		{
+			Axes[PollIndex]->SendGetStatus();
+			return;
+		}
+	}
+}
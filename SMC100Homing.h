@@ -0,0 +1,62 @@
+#ifndef SMC100Homing_h	//check for multiple inclusions
+#define SMC100Homing_h
+
+#include "Arduino.h"
+#include "SMC100.h"
+#include "SMC100Bus.h"
+
+#define SMC100HomingAxesMax 8
+
+class SMC100Homing
+{
+	public:
+		enum class AxisStateType : uint8_t
+		{
+			Waiting,
+			Homing,
+			Done,
+			Failed,
+		};
+		SMC100Homing();
+		SMC100Homing(SMC100Bus* bus);
+		int8_t AddAxis(SMC100* Axis, uint8_t DependsOn);
+		void SetPollInterval(uint32_t Interval);
+		void SetTimeout(uint32_t Time);
+		void SetCompleteCallback(SMC100::FinishedListener Callback);
+		void Start();
+		void Check();
+		bool IsRunning();
+		AxisStateType GetAxisState(uint8_t Index);
+		uint32_t GetAxisTime(uint8_t Index);
+		uint32_t GetTotalTime();
+	private:
+		bool DependenciesDone(uint8_t Index);
+		void StartAxis(uint8_t Index);
+		void CheckAxis(uint8_t Index);
+		void RequestStatus(uint8_t Index);
+		bool StatusUpdated(uint8_t Index);
+		void FinishAxis(uint8_t Index, AxisStateType State);
+		void PollNextAxis();
+		static const uint32_t PollIntervalDefault;
+		static const uint32_t TimeoutDefault;
+		SMC100Bus* Bus;
+		SMC100* Axes[SMC100HomingAxesMax];
+		uint8_t Dependencies[SMC100HomingAxesMax];
+		AxisStateType States[SMC100HomingAxesMax];
+		uint32_t StartTimes[SMC100HomingAxesMax];
+		uint32_t AxisTimes[SMC100HomingAxesMax];
+		uint32_t RequestTimes[SMC100HomingAxesMax];
+		uint32_t StatusCounts[SMC100HomingAxesMax];
+		uint32_t CommandErrors[SMC100HomingAxesMax];
+		uint8_t AxisCount;
+		uint8_t StatusRequestedMask;
+		uint8_t PollIndex;
+		uint32_t PollInterval;
+		uint32_t LastPollTime;
+		uint32_t Timeout;
+		uint32_t StartTime;
+		uint32_t TotalTime;
+		bool Running;
+		SMC100::FinishedListener CompleteCallback;
+};
+#endif
@@ -0,0 +1,193 @@
+#include "SMC100Recorder.h"
+
+SMC100Recorder::SMC100Recorder(uint8_t* buffer, uint32_t size)
+{
+	RecordBuffer = buffer;
+	RecordCapacity = size / SMC100RecordSize;
+	//A buffer too small for one record leaves the recorder permanently disabled.
+	Enabled = (RecordCapacity > 0);
+	Clear();
+}
+
+void SMC100Recorder::RecordFrame(uint32_t Time, uint8_t Axis, const uint8_t* Frame, uint8_t Length)
+{
+	for (uint8_t Index = 0; Index < Length; ++Index)
+	{
+		Record(Time, Axis, DirectionType::Transmit, Frame[Index]);
+	}
+}
+
+void SMC100Recorder::SetEnabled(bool Setting)
+{
+	Enabled = Setting && (RecordCapacity > 0);
+}
+
+void SMC100Recorder::Clear()
+{
+	RecordHead = 0;
+	RecordCount = 0;
+	OverflowFlag = false;
+}
+
+void SMC100Recorder::Restore(uint32_t Count)
+{
+	//For a buffer filled from an earlier Dump(), records are taken as oldest first from the start.
+	if (RecordCapacity == 0)
+	{
+		Clear();
+		return;
+	}
+	if (Count > RecordCapacity)
+	{
+		Count = RecordCapacity;
+	}
+	RecordCount = Count;
+	RecordHead = Count % RecordCapacity;
+	OverflowFlag = false;
+}
+
+uint32_t SMC100Recorder::Count()
+{
+	return RecordCount;
+}
+
+uint32_t SMC100Recorder::Capacity()
+{
+	return RecordCapacity;
+}
+
+bool SMC100Recorder::Overflowed()
+{
+	return OverflowFlag;
+}
+
+bool SMC100Recorder::Get(uint32_t Index, RecordStruct* Entry)
+{
+	if (Index >= RecordCount)
+	{
+		return false;
+	}
+	uint32_t Position = (RecordHead + RecordCapacity - RecordCount + Index) % RecordCapacity;
+	const uint8_t* Source = RecordBuffer + Position * SMC100RecordSize;
+	Entry->Time = (uint32_t)Source[0] | ((uint32_t)Source[1] << 8) | ((uint32_t)Source[2] << 16) | ((uint32_t)Source[3] << 24);
+	Entry->Axis = Source[4] & SMC100RecordAxisMask;
+	Entry->Direction = (Source[4] & SMC100RecordReceiveFlag) ? DirectionType::Receive : DirectionType::Transmit;
+	Entry->Data = Source[5];
+	return true;
+}
+
+void SMC100Recorder::Dump(Print* Output)
+{
+	for (uint32_t Index = 0; Index < RecordCount; ++Index)
+	{
+		uint32_t Position = (RecordHead + RecordCapacity - RecordCount + Index) % RecordCapacity;
+		Output->write(RecordBuffer + Position * SMC100RecordSize, SMC100RecordSize);
+	}
+}
+
+SMC100Replay::SMC100Replay(SMC100Recorder* recording, uint8_t axis)
+{
+	Recording = recording;
+	Axis = axis;
+	Cursor = 0;
+	TimeOffset = 0;
+	MismatchCount = 0;
+}
+
+void SMC100Replay::Start()
+{
+	SMC100Recorder::RecordStruct Entry;
+	Cursor = 0;
+	MismatchCount = 0;
+	TimeOffset = 0;
+	if (NextRecord(&Entry))
+	{
+		TimeOffset = (int32_t)(micros() - Entry.Time);
+	}
+}
+
+bool SMC100Replay::IsFinished()
+{
+	SMC100Recorder::RecordStruct Entry;
+	return !NextRecord(&Entry);
+}
+
+uint32_t SMC100Replay::GetMismatchCount()
+{
+	return MismatchCount;
+}
+
+bool SMC100Replay::NextRecord(SMC100Recorder::RecordStruct* Entry)
+{
+	while (Recording->Get(Cursor, Entry))
+	{
+		if (Entry->Axis == Axis)
+		{
+			return true;
+		}
+		Cursor++;
+	}
+	return false;
+}
+
+bool SMC100Replay::NextReceiveReady()
+{
+	//Received bytes are released at their recorded time relative to the frame that preceded them.
+	SMC100Recorder::RecordStruct Entry;
+	if (!NextRecord(&Entry) || (Entry.Direction != SMC100Recorder::DirectionType::Receive))
+	{
+		return false;
+	}
+	return ( (int32_t)(micros() - (Entry.Time + TimeOffset)) >= 0 );
+}
+
+int SMC100Replay::available()
+{
+	return NextReceiveReady() ? 1 : 0;
+}
+
+int SMC100Replay::read()
+{
+	SMC100Recorder::RecordStruct Entry;
+	if (!NextReceiveReady())
+	{
+		return -1;
+	}
+	NextRecord(&Entry);
+	Cursor++;
+	return Entry.Data;
+}
+
+int SMC100Replay::peek()
+{
+	SMC100Recorder::RecordStruct Entry;
+	if (!NextReceiveReady())
+	{
+		return -1;
+	}
+	NextRecord(&Entry);
+	return Entry.Data;
+}
+
+void SMC100Replay::flush()
+{
+
+}
+
+size_t SMC100Replay::write(uint8_t NewByte)
+{
+	//Transmitted bytes are checked against the recording and re-anchor replay time to the frame being sent.
+	SMC100Recorder::RecordStruct Entry;
+	if (!NextRecord(&Entry) || (Entry.Direction != SMC100Recorder::DirectionType::Transmit))
+	{
+		MismatchCount++;
+		return 1;
+	}
+	TimeOffset = (int32_t)(micros() - Entry.Time);
+	if (Entry.Data != NewByte)
+	{
+		MismatchCount++;
+	}
+	Cursor++;
+	return 1;
+}
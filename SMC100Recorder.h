@@ -0,0 +1,94 @@
+#ifndef SMC100Recorder_h	//check for multiple inclusions
+#define SMC100Recorder_h
+
+#include "Arduino.h"
+
+#define SMC100RecordSize 6
+#define SMC100RecordReceiveFlag 0x80
+#define SMC100RecordAxisMask 0x7F
+
+class SMC100Recorder
+{
+	public:
+		enum class DirectionType : uint8_t
+		{
+			Transmit,
+			Receive,
+		};
+		struct RecordStruct
+		{
+			uint32_t Time;
+			uint8_t Axis;
+			DirectionType Direction;
+			uint8_t Data;
+		};
+		SMC100Recorder(uint8_t* buffer, uint32_t size);
+		inline void Record(uint32_t Time, uint8_t Axis, DirectionType Direction, uint8_t Data)
+		{
+			//Six bytes per record: time little endian, direction and axis, then the byte on the wire.
+			if (!Enabled)
+			{
+				return;
+			}
+			uint8_t* Entry = RecordBuffer + RecordHead * SMC100RecordSize;
+			Entry[0] = (uint8_t)Time;
+			Entry[1] = (uint8_t)(Time >> 8);
+			Entry[2] = (uint8_t)(Time >> 16);
+			Entry[3] = (uint8_t)(Time >> 24);
+			Entry[4] = (Axis & SMC100RecordAxisMask) | ( (Direction == DirectionType::Receive) ? SMC100RecordReceiveFlag : 0 );
+			Entry[5] = Data;
+			RecordHead++;
+			if (RecordHead >= RecordCapacity)
+			{
+				RecordHead = 0;
+			}
+			if (RecordCount < RecordCapacity)
+			{
+				RecordCount++;
+			}
+			else
+			{
+				OverflowFlag = true;
+			}
+		}
+		void RecordFrame(uint32_t Time, uint8_t Axis, const uint8_t* Frame, uint8_t Length);
+		void SetEnabled(bool Setting);
+		void Clear();
+		void Restore(uint32_t Count);
+		uint32_t Count();
+		uint32_t Capacity();
+		bool Overflowed();
+		bool Get(uint32_t Index, RecordStruct* Entry);
+		void Dump(Print* Output);
+	private:
+		uint8_t* RecordBuffer;
+		uint32_t RecordCapacity;
+		uint32_t RecordHead;
+		uint32_t RecordCount;
+		bool OverflowFlag;
+		bool Enabled;
+};
+
+class SMC100Replay : public Stream
+{
+	public:
+		SMC100Replay(SMC100Recorder* recording, uint8_t axis);
+		void Start();
+		bool IsFinished();
+		uint32_t GetMismatchCount();
+		int available();
+		int read();
+		int peek();
+		void flush();
+		size_t write(uint8_t NewByte);
+		using Print::write;
+	private:
+		bool NextRecord(SMC100Recorder::RecordStruct* Entry);
+		bool NextReceiveReady();
+		SMC100Recorder* Recording;
+		uint8_t Axis;
+		uint32_t Cursor;
+		int32_t TimeOffset;
+		uint32_t MismatchCount;
+};
+#endif
@@ -0,0 +1,479 @@
+#include "SMC100Simulator.h"
+
+const uint32_t SMC100Simulator::HomingTime = 200000;
+const uint32_t SMC100Simulator::ConfigurationSaveTime = 500000;
+
+SMC100Simulator::ReplyWriter::ReplyWriter(SMC100Simulator* owner)
+{
+	Owner = owner;
+}
+
+size_t SMC100Simulator::ReplyWriter::write(uint8_t NewByte)
+{
+	Owner->ReplyPut(NewByte);
+	return 1;
+}
+
+SMC100Simulator::SMC100Simulator(uint8_t address) : Writer(this)
+{
+	Address = address;
+	memset(&FaultRates, 0, sizeof(FaultRates));
+	FaultCount = 0;
+	Turnaround = 2000;
+	SetBaudRate(57600);
+	LineIndex = 0;
+	ReplyLength = 0;
+	OutputHead = 0;
+	OutputCount = 0;
+	OutputReadyTime = 0;
+	BusyUntilTime = micros();
+	State = StateType::NoReference;
+	StateEndTime = 0;
+	LastUpdateTime = micros();
+	LastError = '@';
+	Position = 0.0;
+	Target = 0.0;
+	Velocity = 5.0;
+	Acceleration = 20.0;
+	Backlash = 0.0;
+	JerkTime = 0.04;
+	LimitNegative = -25.0;
+	LimitPositive = 25.0;
+	GPIOInput = 0;
+	GPIOOutput = 0;
+}
+
+void SMC100Simulator::SetFaultRates(const FaultRateStruct* Rates)
+{
+	//Rates are per million, bit flips, drops and duplicates per reply byte, the rest per reply.
+	FaultRates = *Rates;
+}
+
+void SMC100Simulator::SetTurnaround(uint32_t Time)
+{
+	Turnaround = Time;
+}
+
+void SMC100Simulator::SetBaudRate(uint32_t BaudRate)
+{
+	ByteTime = (10 * 1000000UL + BaudRate - 1) / BaudRate;
+}
+
+void SMC100Simulator::SetGPIOInput(uint8_t Code)
+{
+	GPIOInput = Code;
+}
+
+SMC100Simulator::StateType SMC100Simulator::GetState()
+{
+	Update();
+	return State;
+}
+
+float SMC100Simulator::GetPosition()
+{
+	Update();
+	return Position;
+}
+
+uint8_t SMC100Simulator::GetGPIOOutput()
+{
+	return GPIOOutput;
+}
+
+uint32_t SMC100Simulator::GetFaultCount()
+{
+	return FaultCount;
+}
+
+int SMC100Simulator::available()
+{
+	if ( (OutputCount > 0) && ((int32_t)(micros() - OutputReadyTime) >= 0) )
+	{
+		return 1;
+	}
+	return 0;
+}
+
+int SMC100Simulator::read()
+{
+	if (!available())
+	{
+		return -1;
+	}
+	uint8_t NewByte = Output[OutputHead];
+	OutputHead = (OutputHead + 1) % SMC100SimulatorOutputSize;
+	OutputCount--;
+	OutputReadyTime += ByteTime;
+	return NewByte;
+}
+
+int SMC100Simulator::peek()
+{
+	if (!available())
+	{
+		return -1;
+	}
+	return Output[OutputHead];
+}
+
+void SMC100Simulator::flush()
+{
+
+}
+
+size_t SMC100Simulator::write(uint8_t NewByte)
+{
+	if (NewByte == '\n')
+	{
+		Line[LineIndex] = '\0';
+		ExecuteCommand();
+		LineIndex = 0;
+	}
+	else if ( (NewByte != '\r') && (LineIndex < (SMC100SimulatorLineSize - 1)) )
+	{
+		Line[LineIndex] = NewByte;
+		LineIndex++;
+	}
+	return 1;
+}
+
+void SMC100Simulator::Update()
+{
+	//Constant velocity motion, acceleration is only reported back through AC.
+	uint32_t Now = micros();
+	float Step = Velocity * (float)(Now - LastUpdateTime) / 1000000.0;
+	LastUpdateTime = Now;
+	if (State == StateType::Moving)
+	{
+		if (fabs(Target - Position) <= Step)
+		{
+			Position = Target;
+			State = StateType::Ready;
+		}
+		else if (Target > Position)
+		{
+			Position += Step;
+		}
+		else
+		{
+			Position -= Step;
+		}
+	}
+	else if ( (State == StateType::Homing) && ((int32_t)(Now - StateEndTime) >= 0) )
+	{
+		Position = 0.0;
+		Target = 0.0;
+		State = StateType::Ready;
+	}
+}
+
+void SMC100Simulator::ExecuteCommand()
+{
+	char* EndOfAddress;
+	uint8_t AddressOfCommand = strtol(Line, &EndOfAddress, 10);
+	if ( (AddressOfCommand != Address) || (strlen(EndOfAddress) < 2) )
+	{
+		return;
+	}
+	Update();
+	char Code[3] = {EndOfAddress[0], EndOfAddress[1], '\0'};
+	const char* ParameterAddress = EndOfAddress + 2;
+	bool IsGet = (*ParameterAddress == '?');
+	bool IsSet = !IsGet && (*ParameterAddress != '\0');
+	float Value = atof(ParameterAddress);
+	if (strcmp(Code, "TS") == 0)
+	{
+		ReplyBegin(Code);
+		Writer.print("0000");
+		Writer.print(StateCode());
+		ReplyEnd();
+	}
+	else if (strcmp(Code, "TE") == 0)
+	{
+		ReplyBegin(Code);
+		Writer.write(LastError);
+		ReplyEnd();
+		LastError = '@';
+	}
+	else if (strcmp(Code, "TP") == 0)
+	{
+		ReplyBegin(Code);
+		Writer.print(Position, 6);
+		ReplyEnd();
+	}
+	else if (strcmp(Code, "TH") == 0)
+	{
+		ReplyBegin(Code);
+		Writer.print(Target, 6);
+		ReplyEnd();
+	}
+	else if (strcmp(Code, "RB") == 0)
+	{
+		ReplyBegin(Code);
+		Writer.print(GPIOInput);
+		ReplyEnd();
+	}
+	else if (strcmp(Code, "RA") == 0)
+	{
+		ReplyBegin(Code);
+		Writer.print(0.0, 6);
+		ReplyEnd();
+	}
+	else if (strcmp(Code, "PT") == 0)
+	{
+		ReplyBegin(Code);
+		Writer.print(fabs(Value) / Velocity, 6);
+		ReplyEnd();
+	}
+	else if ( (strcmp(Code, "PA") == 0) || (strcmp(Code, "PR") == 0) )
+	{
+		if (IsGet)
+		{
+			ReplyBegin(Code);
+			Writer.print(Target, 6);
+			ReplyEnd();
+		}
+		else if ( (State != StateType::Ready) && (State != StateType::Moving) )
+		{
+			LastError = 'H';
+		}
+		else
+		{
+			float NewTarget = (Code[1] == 'A') ? Value : Target + Value;
+			if ( (NewTarget < LimitNegative) || (NewTarget > LimitPositive) )
+			{
+				LastError = 'C';
+			}
+			else
+			{
+				Target = NewTarget;
+				State = StateType::Moving;
+			}
+		}
+	}
+	else if (strcmp(Code, "OR") == 0)
+	{
+		if (State == StateType::NoReference)
+		{
+			State = StateType::Homing;
+			StateEndTime = micros() + HomingTime;
+		}
+		else
+		{
+			LastError = 'H';
+		}
+	}
+	else if (strcmp(Code, "MM") == 0)
+	{
+		if ( IsSet && (Value == 0.0) && (State == StateType::Ready) )
+		{
+			State = StateType::Disabled;
+		}
+		else if ( IsSet && (Value != 0.0) && (State == StateType::Disabled) )
+		{
+			State = StateType::Ready;
+		}
+	}
+	else if (strcmp(Code, "PW") == 0)
+	{
+		if ( IsSet && (Value != 0.0) && (State == StateType::NoReference) )
+		{
+			State = StateType::Configuration;
+		}
+		else if ( IsSet && (Value == 0.0) && (State == StateType::Configuration) )
+		{
+			State = StateType::NoReference;
+			BusyUntilTime = micros() + ConfigurationSaveTime;
+		}
+		else if (IsGet)
+		{
+			ReplyBegin(Code);
+			Writer.print( (State == StateType::Configuration) ? 1 : 0 );
+			ReplyEnd();
+		}
+		else
+		{
+			LastError = 'H';
+		}
+	}
+	else if (strcmp(Code, "RS") == 0)
+	{
+		State = StateType::NoReference;
+	}
+	else if (strcmp(Code, "SB") == 0)
+	{
+		if (IsGet)
+		{
+			ReplyBegin(Code);
+			Writer.print(GPIOOutput);
+			ReplyEnd();
+		}
+		else
+		{
+			GPIOOutput = (uint8_t)Value;
+		}
+	}
+	else if (strcmp(Code, "JM") == 0)
+	{
+
+	}
+	else if ( ExecuteParameter(Code, IsGet, IsSet, Value) )
+	{
+
+	}
+	else
+	{
+		LastError = 'A';
+	}
+}
+
+bool SMC100Simulator::ExecuteParameter(const char* Code, bool IsGet, bool IsSet, float Value)
+{
+	float* Parameter;
+	if (strcmp(Code, "VA") == 0)
+	{
+		Parameter = &Velocity;
+	}
+	else if (strcmp(Code, "AC") == 0)
+	{
+		Parameter = &Acceleration;
+	}
+	else if (strcmp(Code, "BA") == 0)
+	{
+		Parameter = &Backlash;
+	}
+	else if (strcmp(Code, "JR") == 0)
+	{
+		Parameter = &JerkTime;
+	}
+	else if (strcmp(Code, "SL") == 0)
+	{
+		Parameter = &LimitNegative;
+	}
+	else if (strcmp(Code, "SR") == 0)
+	{
+		Parameter = &LimitPositive;
+	}
+	else
+	{
+		return false;
+	}
+	if (IsGet)
+	{
+		ReplyBegin(Code);
+		Writer.print(*Parameter, 6);
+		ReplyEnd();
+	}
+	else if (IsSet)
+	{
+		*Parameter = Value;
+	}
+	return true;
+}
+
+void SMC100Simulator::ReplyBegin(const char* Code)
+{
+	uint8_t ReplyAddress = Address;
+	if (Chance(FaultRates.WrongAddress))
+	{
+		ReplyAddress = Address + 1;
+		FaultCount++;
+	}
+	ReplyLength = 0;
+	Writer.print(ReplyAddress);
+	Writer.write(Code[0]);
+	Writer.write(Code[1]);
+}
+
+void SMC100Simulator::ReplyEnd()
+{
+	//Faults are applied as the reply is queued, timing starts after the turnaround unless a reply is still draining.
+	Writer.write('\r');
+	Writer.write('\n');
+	uint32_t StartTime = micros() + Turnaround;
+	if ( (int32_t)(BusyUntilTime - StartTime) > 0 )
+	{
+		StartTime = BusyUntilTime;
+	}
+	//Kept recent, so the signed comparison above still holds on a clock that has run for a long time.
+	BusyUntilTime = StartTime;
+	if (Chance(FaultRates.Delay))
+	{
+		StartTime += FaultRates.DelayTime;
+		FaultCount++;
+	}
+	if (OutputCount == 0)
+	{
+		OutputReadyTime = StartTime;
+	}
+	for (uint8_t Index = 0; Index < ReplyLength; ++Index)
+	{
+		uint8_t NewByte = Reply[Index];
+		if (Chance(FaultRates.Drop))
+		{
+			FaultCount++;
+			continue;
+		}
+		if (Chance(FaultRates.BitFlip))
+		{
+			NewByte ^= (1 << random(8));
+			FaultCount++;
+		}
+		OutputPut(NewByte);
+		if (Chance(FaultRates.Duplicate))
+		{
+			OutputPut(NewByte);
+			FaultCount++;
+		}
+	}
+}
+
+void SMC100Simulator::ReplyPut(uint8_t NewByte)
+{
+	if (ReplyLength < SMC100SimulatorOutputSize)
+	{
+		Reply[ReplyLength] = NewByte;
+		ReplyLength++;
+	}
+}
+
+void SMC100Simulator::OutputPut(uint8_t NewByte)
+{
+	if (OutputCount >= SMC100SimulatorOutputSize)
+	{
+		return;
+	}
+	Output[(OutputHead + OutputCount) % SMC100SimulatorOutputSize] = NewByte;
+	OutputCount++;
+}
+
+bool SMC100Simulator::Chance(uint32_t PerMillion)
+{
+	if (PerMillion == 0)
+	{
+		return false;
+	}
+	return ((uint32_t)random(1000000) < PerMillion);
+}
+
+const char* SMC100Simulator::StateCode()
+{
+	switch (State)
+	{
+		case StateType::NoReference:
+			return "0A";
+		case StateType::Configuration:
+			return "14";
+		case StateType::Homing:
+			return "1E";
+		case StateType::Moving:
+			return "28";
+		case StateType::Ready:
+			return "33";
+		case StateType::Disabled:
+			return "3C";
+		default:
+			return "0A";
+	}
+}
@@ -0,0 +1,96 @@
+#ifndef SMC100Simulator_h	//check for multiple inclusions
+#define SMC100Simulator_h
+
+#include "Arduino.h"
+
+#define SMC100SimulatorLineSize 32
+#define SMC100SimulatorOutputSize 64
+
+class SMC100Simulator : public Stream
+{
+	public:
+		enum class StateType : uint8_t
+		{
+			NoReference,
+			Configuration,
+			Homing,
+			Moving,
+			Ready,
+			Disabled,
+		};
+		struct FaultRateStruct
+		{
+			uint32_t BitFlip;
+			uint32_t Drop;
+			uint32_t Duplicate;
+			uint32_t WrongAddress;
+			uint32_t Delay;
+			uint32_t DelayTime;
+		};
+		SMC100Simulator(uint8_t address);
+		void SetFaultRates(const FaultRateStruct* Rates);
+		void SetTurnaround(uint32_t Time);
+		void SetBaudRate(uint32_t BaudRate);
+		void SetGPIOInput(uint8_t Code);
+		StateType GetState();
+		float GetPosition();
+		uint8_t GetGPIOOutput();
+		uint32_t GetFaultCount();
+		int available();
+		int read();
+		int peek();
+		void flush();
+		size_t write(uint8_t NewByte);
+		using Print::write;
+	private:
+		class ReplyWriter : public Print
+		{
+			public:
+				ReplyWriter(SMC100Simulator* owner);
+				size_t write(uint8_t NewByte);
+				using Print::write;
+			private:
+				SMC100Simulator* Owner;
+		};
+		void Update();
+		void ExecuteCommand();
+		bool ExecuteParameter(const char* Code, bool IsGet, bool IsSet, float Value);
+		void ReplyBegin(const char* Code);
+		void ReplyEnd();
+		void ReplyPut(uint8_t NewByte);
+		void OutputPut(uint8_t NewByte);
+		bool Chance(uint32_t PerMillion);
+		const char* StateCode();
+		static const uint32_t HomingTime;
+		static const uint32_t ConfigurationSaveTime;
+		uint8_t Address;
+		FaultRateStruct FaultRates;
+		uint32_t FaultCount;
+		uint32_t Turnaround;
+		uint32_t ByteTime;
+		char Line[SMC100SimulatorLineSize];
+		uint8_t LineIndex;
+		uint8_t Reply[SMC100SimulatorOutputSize];
+		uint8_t ReplyLength;
+		uint8_t Output[SMC100SimulatorOutputSize];
+		uint8_t OutputHead;
+		uint8_t OutputCount;
+		uint32_t OutputReadyTime;
+		uint32_t BusyUntilTime;
+		ReplyWriter Writer;
+		StateType State;
+		uint32_t StateEndTime;
+		uint32_t LastUpdateTime;
+		char LastError;
+		float Position;
+		float Target;
+		float Velocity;
+		float Acceleration;
+		float Backlash;
+		float JerkTime;
+		float LimitNegative;
+		float LimitPositive;
+		uint8_t GPIOInput;
+		uint8_t GPIOOutput;
+};
+#endif
@@ -0,0 +1,163 @@
+#include <SMC100.h>
+#include <SMC100Simulator.h>
+
+//Drives one axis against a simulated controller that corrupts its replies, and reports how the driver recovers.
+//On Linux, make in extras/host builds this sketch as smc100soak, which runs it on a virtual clock.
+
+const uint32_t CommandTotal = 1000000;
+const uint32_t ReportEvery = 10000;
+const uint32_t FastBaudRate = 1000000;
+const float PositionTolerance = 0.001;
+
+SMC100Simulator Simulator(1);
+SMC100 Stage(&Simulator, 1);
+uint32_t CommandsIssued = 0;
+uint32_t PositionChecks = 0;
+uint32_t WrongPositions = 0;
+uint32_t GPIOChecks = 0;
+uint32_t WrongGPIO = 0;
+uint32_t CommandErrorsSeen = 0;
+
+void MoveComplete()
+{
+	PositionChecks++;
+	if (fabs(Stage.GetPosition() - Simulator.GetPosition()) > PositionTolerance)
+	{
+		WrongPositions++;
+	}
+}
+
+void GPIOReturn()
+{
+	GPIOChecks++;
+	for (uint8_t Pin = 0; Pin < 4; ++Pin)
+	{
+		if (Stage.GetGPIOInput(Pin) != (bool)bitRead(0x5, Pin))
+		{
+			WrongGPIO++;
+			break;
+		}
+	}
+}
+
+void Report()
+{
+	const SMC100::ErrorCountStruct* Counts = Stage.GetErrorCounts();
+	uint32_t Errors = Counts->AddressMismatch + Counts->CommandMismatch + Counts->BufferOverflow + Counts->Timeout + Counts->StatusUnknown + Counts->Malformed + Counts->CommandError;
+	Serial.print("<Soak>(Commands: ");
+	Serial.print(CommandsIssued);
+	Serial.print(" Replies: ");
+	Serial.print(Counts->Replies);
+	Serial.print(" Errors: ");
+	Serial.print(Errors);
+	Serial.print(" Success: ");
+	Serial.print(100.0 * (float)Counts->Replies / (float)(Counts->Replies + Errors), 3);
+	Serial.print("% Faults injected: ");
+	Serial.print(Simulator.GetFaultCount());
+	Serial.print(")\n<Soak>(Address: ");
+	Serial.print(Counts->AddressMismatch);
+	Serial.print(" Command: ");
+	Serial.print(Counts->CommandMismatch);
+	Serial.print(" Overflow: ");
+	Serial.print(Counts->BufferOverflow);
+	Serial.print(" Timeout: ");
+	Serial.print(Counts->Timeout);
+	Serial.print(" Status: ");
+	Serial.print(Counts->StatusUnknown);
+	Serial.print(" Malformed: ");
+	Serial.print(Counts->Malformed);
+	Serial.print(" Controller: ");
+	Serial.print(Counts->CommandError);
+	Serial.print(")\n<Soak>(Wrong position: ");
+	Serial.print(WrongPositions);
+	Serial.print("/");
+	Serial.print(PositionChecks);
+	Serial.print(" Wrong GPIO: ");
+	Serial.print(WrongGPIO);
+	Serial.print("/");
+	Serial.print(GPIOChecks);
+	Serial.print(")\n<Soak>(Resync ms <1");
+	for (uint8_t Bin = 1; Bin < SMC100ResyncBins; ++Bin)
+	{
+		Serial.print(" <");
+		Serial.print(1UL << Bin);
+	}
+	Serial.print("+:");
+	for (uint8_t Bin = 0; Bin < SMC100ResyncBins; ++Bin)
+	{
+		Serial.print(" ");
+		Serial.print(Counts->ResyncHistogram[Bin]);
+	}
+	Serial.print(" max us: ");
+	Serial.print(Counts->ResyncTimeMax);
+	Serial.print(")\n");
+}
+
+void setup()
+{
+	Serial.begin(115200);
+	randomSeed(1);
+	SMC100Simulator::FaultRateStruct Rates;
+	Rates.BitFlip = 200;
+	Rates.Drop = 200;
+	Rates.Duplicate = 200;
+	Rates.WrongAddress = 500;
+	Rates.Delay = 500;
+	Rates.DelayTime = 50000;
+	Simulator.SetFaultRates(&Rates);
+	Simulator.SetBaudRate(FastBaudRate);
+	Simulator.SetTurnaround(200);
+	Simulator.SetGPIOInput(0x5);
+	Stage.SetBaudRate(FastBaudRate);
+	Stage.SetVerbose(false);
+	Stage.SetMoveCompleteCallback(MoveComplete);
+	Stage.SetGPIOReturnCallback(GPIOReturn);
+	Stage.Begin();
+}
+
+void loop()
+{
+	Stage.Check();
+	if ( Stage.IsBusy() || !Stage.AreLimitsValid() )
+	{
+		return;
+	}
+	if (Stage.GetErrorCounts()->CommandError != CommandErrorsSeen)
+	{
+		//A rejected command is followed by a fresh status before the next decision.
+		CommandErrorsSeen = Stage.GetErrorCounts()->CommandError;
+		Stage.SendGetStatus();
+		return;
+	}
+	if (!Stage.IsHomed())
+	{
+		if (Stage.GetStatus() == SMC100::StatusType::NoReference)
+		{
+			Stage.Home();
+		}
+		else
+		{
+			Stage.SendGetStatus();
+		}
+	}
+	else if (CommandsIssued < CommandTotal)
+	{
+		switch (CommandsIssued % 3)
+		{
+			case 0:
+				Stage.MoveAbsolute( (float)random(-100, 100) / 1000.0 );
+				break;
+			case 1:
+				Stage.SetGPIOOutputAll(random(16));
+				break;
+			default:
+				Stage.SendGetGPIOInput();
+				break;
+		}
+		CommandsIssued++;
+		if ( (CommandsIssued % ReportEvery) == 0 )
+		{
+			Report();
+		}
+	}
+}
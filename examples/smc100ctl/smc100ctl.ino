@@ -0,0 +1,303 @@
+#include <SMC100.h>
+#include <SMC100Simulator.h>
+
+//Batch runner: reads a motion script over the USB serial port and executes it pipelined through the command queue.
+//Every line is acknowledged with "<smc100ctl>(ok)" once it has been taken, the host sends the next line only then.
+//smc100send.sh in this folder does that, e.g. "./smc100send.sh /dev/ttyACM0 script.txt". One command per line:
+//  move <position>      queue an absolute move
+//  gpio <pin> <0|1>     queue a single SB output
+//  gpioall <code>       queue all SB outputs
+//  home                 queue OR
+//  wait <ms>            pause the script
+//  sync                 wait until every queued command has completed
+//  query position|gpio  sync, read back and print
+//  end                  print throughput and reset the counters
+//The controller is on Serial1, define SMC100ctlUseSimulator as 1 to run against the built in simulator instead.
+//On Linux, make in extras/host builds this sketch as smc100ctl, with Serial1 on a serial device or pty.
+
+#ifndef SMC100ctlUseSimulator
+#define SMC100ctlUseSimulator 0
+#endif
+#define SMC100ctlLineSize 64
+
+const uint32_t HostBaudRate = 115200;
+const uint8_t ControllerAddress = 1;
+
+#if SMC100ctlUseSimulator
+SMC100Simulator Controller(ControllerAddress);
+SMC100 Stage(&Controller, ControllerAddress);
+#else
+SMC100 Stage(&Serial1, ControllerAddress);
+#endif
+
+enum class ScriptStateType : uint8_t
+{
+	Reading,
+	WaitSpace,
+	WaitTime,
+	WaitSync,
+};
+
+enum class QueryType : uint8_t
+{
+	None,
+	Position,
+	GPIO,
+};
+
+char Line[SMC100ctlLineSize];
+uint8_t LineIndex = 0;
+ScriptStateType ScriptState = ScriptStateType::Reading;
+QueryType PendingQuery = QueryType::None;
+uint32_t StepCount = 0;
+uint32_t StepStartTime = 0;
+uint32_t WaitUntilTime = 0;
+uint32_t RunStartTime = 0;
+uint32_t RunStartReplies = 0;
+bool RunStarted = false;
+
+void Acknowledge()
+{
+	Serial.print("<smc100ctl>(ok)\n");
+}
+
+void PrintTime(uint32_t Time)
+{
+	Serial.print((float)Time / 1000.0, 3);
+	Serial.print(" ms");
+}
+
+void PrintStep(const char* Action)
+{
+	Serial.print("<smc100ctl>(step ");
+	Serial.print(StepCount);
+	Serial.print(" ");
+	Serial.print(Action);
+	Serial.print(" at ");
+	PrintTime(micros() - RunStartTime);
+	Serial.print(")\n");
+}
+
+void PrintStepDone()
+{
+	Serial.print("<smc100ctl>(step ");
+	Serial.print(StepCount);
+	Serial.print(" done after ");
+	PrintTime(micros() - StepStartTime);
+	if (PendingQuery == QueryType::Position)
+	{
+		Serial.print(" position ");
+		Serial.print(Stage.GetPosition(), 6);
+	}
+	else if (PendingQuery == QueryType::GPIO)
+	{
+		Serial.print(" gpio");
+		for (uint8_t Pin = 0; Pin < 4; ++Pin)
+		{
+			Serial.print(" ");
+			Serial.print(Stage.GetGPIOInput(Pin));
+		}
+	}
+	Serial.print(")\n");
+	PendingQuery = QueryType::None;
+}
+
+void PrintSummary()
+{
+	uint32_t Elapsed = micros() - RunStartTime;
+	const SMC100::ErrorCountStruct* Counts = Stage.GetErrorCounts();
+	uint32_t Replies = Counts->Replies - RunStartReplies;
+	float Seconds = (float)Elapsed / 1000000.0;
+	Serial.print("<smc100ctl>(steps ");
+	Serial.print(StepCount);
+	Serial.print(" in ");
+	PrintTime(Elapsed);
+	Serial.print(", ");
+	Serial.print( (Seconds > 0.0) ? ((float)StepCount / Seconds) : 0.0, 1 );
+	Serial.print(" steps/s, ");
+	Serial.print( (Seconds > 0.0) ? ((float)Replies / Seconds) : 0.0, 1 );
+	Serial.print(" replies/s, timeouts ");
+	Serial.print(Counts->Timeout);
+	Serial.print(")\n");
+	StepCount = 0;
+	RunStarted = false;
+}
+
+bool IsQueuedCommand(const char* Command)
+{
+	return ( (strcmp(Command, "move") == 0) || (strcmp(Command, "gpio") == 0) || (strcmp(Command, "gpioall") == 0) || (strcmp(Command, "home") == 0) );
+}
+
+void QueueCommand(const char* Command, char* Arguments)
+{
+	if (strcmp(Command, "move") == 0)
+	{
+		Stage.MoveAbsolute(atof(Arguments));
+	}
+	else if (strcmp(Command, "gpio") == 0)
+	{
+		char* Value;
+		uint8_t Pin = (uint8_t)strtol(Arguments, &Value, 10);
+		Stage.SetGPIOOutput(Pin, atoi(Value) != 0);
+	}
+	else if (strcmp(Command, "gpioall") == 0)
+	{
+		Stage.SetGPIOOutputAll((uint8_t)atoi(Arguments));
+	}
+	else
+	{
+		Stage.Home();
+	}
+}
+
+void ExecuteLine()
+{
+	char* Command = Line;
+	while (*Command == ' ')
+	{
+		Command++;
+	}
+	if ( (*Command == '\0') || (*Command == '#') )
+	{
+		return;
+	}
+	char* Arguments = Command;
+	while ( (*Arguments != '\0') && (*Arguments != ' ') )
+	{
+		Arguments++;
+	}
+	if (*Arguments != '\0')
+	{
+		*Arguments = '\0';
+		Arguments++;
+	}
+	if ( IsQueuedCommand(Command) && Stage.IsQueueFull() )
+	{
+		//Put the separator back so the whole line is parsed again once the queue has space.
+		if (*Arguments != '\0')
+		{
+			*(Arguments - 1) = ' ';
+		}
+		ScriptState = ScriptStateType::WaitSpace;
+		return;
+	}
+	if (strcmp(Command, "end") == 0)
+	{
+		PrintSummary();
+		return;
+	}
+	if (!RunStarted)
+	{
+		RunStarted = true;
+		RunStartTime = micros();
+		RunStartReplies = Stage.GetErrorCounts()->Replies;
+	}
+	StepCount++;
+	StepStartTime = micros();
+	if (IsQueuedCommand(Command))
+	{
+		PrintStep(Command);
+		QueueCommand(Command, Arguments);
+	}
+	else if (strcmp(Command, "wait") == 0)
+	{
+		PrintStep(Command);
+		WaitUntilTime = micros() + (uint32_t)atol(Arguments) * 1000;
+		ScriptState = ScriptStateType::WaitTime;
+	}
+	else if (strcmp(Command, "sync") == 0)
+	{
+		PrintStep(Command);
+		ScriptState = ScriptStateType::WaitSync;
+	}
+	else if (strcmp(Command, "query") == 0)
+	{
+		PrintStep(Command);
+		if (strcmp(Arguments, "gpio") == 0)
+		{
+			PendingQuery = QueryType::GPIO;
+			Stage.SendGetGPIOInput();
+		}
+		else
+		{
+			PendingQuery = QueryType::Position;
+			Stage.SendGetStatus();
+		}
+		ScriptState = ScriptStateType::WaitSync;
+	}
+	else
+	{
+		StepCount--;
+		Serial.print("<smc100ctl>(Unknown command ");
+		Serial.print(Command);
+		Serial.print(")\n");
+	}
+}
+
+void setup()
+{
+	Serial.begin(HostBaudRate);
+#if !SMC100ctlUseSimulator
+	Serial1.begin(SMC100DefaultBaudRate);
+#endif
+	Stage.Begin();
+}
+
+void loop()
+{
+	Stage.Check();
+	switch (ScriptState)
+	{
+		case ScriptStateType::Reading:
+			while (Serial.available())
+			{
+				char NewChar = Serial.read();
+				if ( (NewChar == '\n') || (NewChar == '\r') )
+				{
+					Line[LineIndex] = '\0';
+					LineIndex = 0;
+					ExecuteLine();
+					if (ScriptState != ScriptStateType::Reading)
+					{
+						break;
+					}
+					Acknowledge();
+				}
+				else if (LineIndex < (SMC100ctlLineSize - 1))
+				{
+					Line[LineIndex] = NewChar;
+					LineIndex++;
+				}
+			}
+			break;
+		case ScriptStateType::WaitSpace:
+			if (!Stage.IsQueueFull())
+			{
+				ScriptState = ScriptStateType::Reading;
+				ExecuteLine();
+				if (ScriptState == ScriptStateType::Reading)
+				{
+					Acknowledge();
+				}
+			}
+			break;
+		case ScriptStateType::WaitTime:
+			if ( (int32_t)(micros() - WaitUntilTime) >= 0 )
+			{
+				PrintStepDone();
+				ScriptState = ScriptStateType::Reading;
+				Acknowledge();
+			}
+			break;
+		case ScriptStateType::WaitSync:
+			if ( !Stage.IsBusy() && Stage.AreLimitsValid() )
+			{
+				PrintStepDone();
+				ScriptState = ScriptStateType::Reading;
+				Acknowledge();
+			}
+			break;
+		default:
+			break;
+	}
+}
@@ -0,0 +1,53 @@
+#!/bin/bash
+#Sends a smc100ctl script one line at a time and prints what the sketch reports.
+#The next line is only written once the sketch has acknowledged the previous one, so nothing is lost
+#while it waits, syncs or has a full command queue.
+#Usage: smc100send.sh <port> <script|-> [baud]
+#A script of - is read from standard input, so a generated script can be piped in.
+#
+#To try it without hardware, extras/host builds the sketch for Linux as smc100ctl and a pty controller
+#simulator as smc100sim. smc100ctl takes its script on standard input and drives the controller port given:
+#  cd extras/host && make
+#  ./smc100sim 1 > pty.txt &
+#  ./smc100ctl $(head -1 pty.txt) < script.txt
+
+if [ $# -lt 2 ]; then
+	echo "Usage: $0 <port> <script|-> [baud]" >&2
+	exit 1
+fi
+Port=$1
+Script=$2
+BaudRate=${3:-115200}
+Acknowledgement='<smc100ctl>(ok)'
+
+if [ "$Script" = "-" ]; then
+	exec 4<&0
+else
+	exec 4<"$Script" || exit 1
+fi
+stty -F "$Port" "$BaudRate" raw -echo || exit 1
+exec 3<>"$Port"
+
+#Prints replies until the acknowledgement, gives up after Timeout seconds without a reply when one is given.
+WaitForAcknowledgement()
+{
+	local Reply
+	while IFS= read -r ${1:+-t "$1"} Reply <&3; do
+		Reply=${Reply%$'\r'}
+		if [ "$Reply" = "$Acknowledgement" ]; then
+			return 0
+		fi
+		echo "$Reply"
+	done
+	return 1
+}
+
+#The board may still be starting after the port was opened, empty lines are sent until one is acknowledged.
+until printf '\n' >&3 && WaitForAcknowledgement 1; do
+	:
+done
+
+while IFS= read -r Line || [ -n "$Line" ]; do
+	printf '%s\n' "$Line" >&3
+	WaitForAcknowledgement || exit 1
+done <&4
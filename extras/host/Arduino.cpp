@@ -0,0 +1,303 @@
+#include "Arduino.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+static bool ClockVirtual = false;
+static uint32_t ClockVirtualNow = 0;
+static uint32_t RandomState = 1;
+
+HardwareSerial Serial(STDIN_FILENO, STDOUT_FILENO);
+
+void HostClockVirtual(bool Setting)
+{
+	ClockVirtual = Setting;
+}
+
+void HostClockAdvance(uint32_t Microseconds)
+{
+	ClockVirtualNow += Microseconds;
+}
+
+uint32_t micros()
+{
+	if (ClockVirtual)
+	{
+		return ClockVirtualNow++;
+	}
+	struct timespec Now;
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return (uint32_t)( (uint64_t)Now.tv_sec * 1000000ULL + (uint64_t)Now.tv_nsec / 1000ULL );
+}
+
+uint32_t millis()
+{
+	if (ClockVirtual)
+	{
+		return ClockVirtualNow / 1000;
+	}
+	struct timespec Now;
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return (uint32_t)( (uint64_t)Now.tv_sec * 1000ULL + (uint64_t)Now.tv_nsec / 1000000ULL );
+}
+
+void delay(uint32_t Milliseconds)
+{
+	delayMicroseconds(Milliseconds * 1000);
+}
+
+void delayMicroseconds(uint32_t Microseconds)
+{
+	if (ClockVirtual)
+	{
+		HostClockAdvance(Microseconds);
+		return;
+	}
+	usleep(Microseconds);
+}
+
+long random(long HowBig)
+{
+	//Xorshift, so a seed gives the same sequence on every host.
+	if (HowBig <= 0)
+	{
+		return 0;
+	}
+	RandomState ^= RandomState << 13;
+	RandomState ^= RandomState >> 17;
+	RandomState ^= RandomState << 5;
+	return (long)(RandomState % (uint32_t)HowBig);
+}
+
+long random(long HowSmall, long HowBig)
+{
+	if (HowSmall >= HowBig)
+	{
+		return HowSmall;
+	}
+	return HowSmall + random(HowBig - HowSmall);
+}
+
+void randomSeed(unsigned long Seed)
+{
+	RandomState = (Seed == 0) ? 1 : (uint32_t)Seed;
+}
+
+size_t Print::write(const uint8_t* Buffer, size_t Size)
+{
+	size_t Written = 0;
+	while (Size--)
+	{
+		Written += write(*Buffer++);
+	}
+	return Written;
+}
+
+size_t Print::write(const char* String)
+{
+	if (String == NULL)
+	{
+		return 0;
+	}
+	return write((const uint8_t*)String, strlen(String));
+}
+
+size_t Print::write(const char* Buffer, size_t Size)
+{
+	return write((const uint8_t*)Buffer, Size);
+}
+
+size_t Print::print(const char* String)
+{
+	return write(String);
+}
+
+size_t Print::print(char Character)
+{
+	return write((uint8_t)Character);
+}
+
+size_t Print::print(unsigned char Value, int Base)
+{
+	return print((unsigned long)Value, Base);
+}
+
+size_t Print::print(int Value, int Base)
+{
+	return print((long)Value, Base);
+}
+
+size_t Print::print(unsigned int Value, int Base)
+{
+	return print((unsigned long)Value, Base);
+}
+
+size_t Print::print(long Value, int Base)
+{
+	if ( (Base == DEC) && (Value < 0) )
+	{
+		return print('-') + PrintNumber(-(unsigned long)Value, Base);
+	}
+	return PrintNumber((unsigned long)Value, Base);
+}
+
+size_t Print::print(unsigned long Value, int Base)
+{
+	return PrintNumber(Value, Base);
+}
+
+size_t Print::print(double Value, int Digits)
+{
+	char Buffer[64];
+	snprintf(Buffer, sizeof(Buffer), "%.*f", Digits, Value);
+	return write(Buffer);
+}
+
+size_t Print::println()
+{
+	return write("\r\n");
+}
+
+size_t Print::PrintNumber(unsigned long Value, int Base)
+{
+	char Buffer[8 * sizeof(unsigned long) + 1];
+	char* Digit = &Buffer[sizeof(Buffer) - 1];
+	*Digit = '\0';
+	if (Base < 2)
+	{
+		Base = DEC;
+	}
+	do
+	{
+		unsigned long Remainder = Value % Base;
+		Value /= Base;
+		*--Digit = (Remainder < 10) ? ('0' + Remainder) : ('A' + Remainder - 10);
+	} while (Value != 0);
+	return write(Digit);
+}
+
+HardwareSerial::HardwareSerial(int InputFile, int OutputFile)
+{
+	this->InputFile = InputFile;
+	this->OutputFile = OutputFile;
+	Peeked = -1;
+	InputEnded = false;
+}
+
+void HardwareSerial::begin(unsigned long BaudRate)
+{
+	(void)BaudRate;
+}
+
+int HardwareSerial::available()
+{
+	//One byte is read ahead, so end of input is seen here rather than as a read that never completes.
+	if ( (Peeked < 0) && !InputEnded )
+	{
+		struct pollfd Request = {InputFile, POLLIN, 0};
+		if ( (poll(&Request, 1, 0) > 0) && (Request.revents & (POLLIN | POLLHUP)) )
+		{
+			uint8_t NewByte;
+			if (::read(InputFile, &NewByte, 1) == 1)
+			{
+				Peeked = NewByte;
+			}
+			else
+			{
+				InputEnded = true;
+			}
+		}
+	}
+	return (Peeked >= 0) ? 1 : 0;
+}
+
+int HardwareSerial::read()
+{
+	int NewByte = peek();
+	Peeked = -1;
+	return NewByte;
+}
+
+int HardwareSerial::peek()
+{
+	available();
+	return Peeked;
+}
+
+bool HardwareSerial::IsInputEnded()
+{
+	return ( InputEnded && (Peeked < 0) );
+}
+
+size_t HardwareSerial::write(uint8_t NewByte)
+{
+	return write(&NewByte, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* Buffer, size_t Size)
+{
+	size_t Written = 0;
+	while (Written < Size)
+	{
+		ssize_t Result = ::write(OutputFile, Buffer + Written, Size - Written);
+		if ( (Result < 0) && (errno == EAGAIN) )
+		{
+			struct pollfd Request = {OutputFile, POLLOUT, 0};
+			poll(&Request, 1, 10);
+			continue;
+		}
+		if (Result <= 0)
+		{
+			break;
+		}
+		Written += Result;
+	}
+	return Written;
+}
+
+HostSerialPort::HostSerialPort() : HardwareSerial(-1, -1)
+{
+
+}
+
+bool HostSerialPort::Open(const char* Path)
+{
+	InputFile = open(Path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	OutputFile = InputFile;
+	Peeked = -1;
+	InputEnded = (InputFile < 0);
+	return (InputFile >= 0);
+}
+
+void HostSerialPort::begin(unsigned long BaudRate)
+{
+	static const struct
+	{
+		unsigned long BaudRate;
+		speed_t Speed;
+	} Speeds[] =
+	{
+		{9600, B9600}, {19200, B19200}, {38400, B38400}, {57600, B57600}, {115200, B115200}, {230400, B230400}, {460800, B460800}, {921600, B921600}
+	};
+	struct termios Settings;
+	if (tcgetattr(InputFile, &Settings) != 0)
+	{
+		return;
+	}
+	cfmakeraw(&Settings);
+	Settings.c_cflag |= CLOCAL | CREAD;
+	Settings.c_cc[VMIN] = 0;
+	Settings.c_cc[VTIME] = 0;
+	for (uint8_t Index = 0; Index < sizeof(Speeds) / sizeof(Speeds[0]); ++Index)
+	{
+		if (Speeds[Index].BaudRate == BaudRate)
+		{
+			cfsetispeed(&Settings, Speeds[Index].Speed);
+			cfsetospeed(&Settings, Speeds[Index].Speed);
+		}
+	}
+	tcsetattr(InputFile, TCSANOW, &Settings);
+}
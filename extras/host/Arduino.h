@@ -0,0 +1,119 @@
+#ifndef Arduino_h	//check for multiple inclusions
+#define Arduino_h
+
+//Just enough of the Arduino core to build the library and its examples on a Linux host.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+
+template <typename TypeA, typename TypeB> inline auto min(TypeA A, TypeB B) -> decltype(true ? TypeA() : TypeB())
+{
+	return (A < B) ? A : B;
+}
+template <typename TypeA, typename TypeB> inline auto max(TypeA A, TypeB B) -> decltype(true ? TypeA() : TypeB())
+{
+	return (A > B) ? A : B;
+}
+template <typename Type, typename TypeLow, typename TypeHigh> inline Type constrain(Type Value, TypeLow Low, TypeHigh High)
+{
+	return (Value < Low) ? Low : ( (Value > High) ? High : Value );
+}
+
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t Milliseconds);
+void delayMicroseconds(uint32_t Microseconds);
+long random(long HowBig);
+long random(long HowSmall, long HowBig);
+void randomSeed(unsigned long Seed);
+
+//The clock is real by default, a virtual clock only moves when advanced and by one microsecond per read.
+void HostClockVirtual(bool Setting);
+void HostClockAdvance(uint32_t Microseconds);
+
+class Print
+{
+	public:
+		virtual ~Print() {}
+		virtual size_t write(uint8_t NewByte) = 0;
+		virtual size_t write(const uint8_t* Buffer, size_t Size);
+		size_t write(const char* String);
+		size_t write(const char* Buffer, size_t Size);
+		virtual void flush() {}
+		size_t print(const char* String);
+		size_t print(char Character);
+		size_t print(unsigned char Value, int Base = DEC);
+		size_t print(int Value, int Base = DEC);
+		size_t print(unsigned int Value, int Base = DEC);
+		size_t print(long Value, int Base = DEC);
+		size_t print(unsigned long Value, int Base = DEC);
+		size_t print(double Value, int Digits = 2);
+		template <typename Type> size_t println(Type Value)
+		{
+			return print(Value) + println();
+		}
+		template <typename Type> size_t println(Type Value, int Format)
+		{
+			return print(Value, Format) + println();
+		}
+		size_t println();
+	private:
+		size_t PrintNumber(unsigned long Value, int Base);
+};
+
+class Stream : public Print
+{
+	public:
+		virtual int available() = 0;
+		virtual int read() = 0;
+		virtual int peek() = 0;
+};
+
+//A serial port on a pair of file descriptors, Serial is stdin and stdout.
+class HardwareSerial : public Stream
+{
+	public:
+		HardwareSerial(int InputFile, int OutputFile);
+		virtual void begin(unsigned long BaudRate);
+		int available();
+		int read();
+		int peek();
+		size_t write(uint8_t NewByte);
+		size_t write(const uint8_t* Buffer, size_t Size);
+		using Print::write;
+		bool IsInputEnded();
+	protected:
+		int InputFile;
+		int OutputFile;
+		int Peeked;
+		bool InputEnded;
+};
+
+//A serial device or pty opened by path, begin() makes it raw at the given baud rate.
+class HostSerialPort : public HardwareSerial
+{
+	public:
+		HostSerialPort();
+		bool Open(const char* Path);
+		void begin(unsigned long BaudRate);
+};
+
+extern HardwareSerial Serial;
+
+#endif
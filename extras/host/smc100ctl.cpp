@@ -0,0 +1,42 @@
+//Runs the smc100ctl example on Linux, with the script on stdin and the controller on Serial1.
+//Usage: smc100ctl <port> < script.txt
+//Serial1 is the serial device or pty given as port, smc100sim provides a pty to test against.
+//The program exits once the script has ended and everything it queued has completed.
+
+#include <Arduino.h>
+#include <unistd.h>
+
+HostSerialPort Serial1;
+
+#include "../../examples/smc100ctl/smc100ctl.ino"
+
+const uint32_t StepTime = 20;
+
+bool ScriptFinished()
+{
+	return ( Serial.IsInputEnded() && (ScriptState == ScriptStateType::Reading) && !Stage.IsBusy() && Stage.AreLimitsValid() );
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: %s <port> < script\n", argv[0]);
+		return 2;
+	}
+	if (!Serial1.Open(argv[1]))
+	{
+		fprintf(stderr, "%s: cannot open %s\n", argv[0], argv[1]);
+		return 1;
+	}
+	setup();
+	//Commands queued by the last line are only pulled on the next Check(), so idle has to be seen twice.
+	uint8_t IdleChecks = 0;
+	while (IdleChecks < 2)
+	{
+		loop();
+		IdleChecks = ScriptFinished() ? (IdleChecks + 1) : 0;
+		usleep(StepTime);
+	}
+	return (Stage.GetErrorCounts()->Timeout == 0) ? 0 : 1;
+}
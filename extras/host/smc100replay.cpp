@@ -0,0 +1,208 @@
+#include <SMC100.h>
+#include <vector>
+
+//Replays a file written by SMC100Recorder::Dump() through the driver's reply parser with the recorded timing.
+//Usage: smc100replay <dump file> [axis] [baud rate]
+//The driver issues its own start up, follow up and polling queries, the moves, homes, outputs and enables
+//in the recording are queued at their recorded time. Replay runs on the virtual clock, so a long trace
+//replays in less than its recorded time.
+
+const uint32_t StepTime = 10;
+const uint32_t SettleTime = 1000000;
+
+struct RecordedCommand
+{
+	uint32_t Time;
+	char Command[3];
+	float Parameter;
+};
+
+static bool LoadDump(const char* Path, std::vector<uint8_t>* Buffer)
+{
+	FILE* File = fopen(Path, "rb");
+	if (File == NULL)
+	{
+		return false;
+	}
+	uint8_t Block[4096];
+	size_t Length;
+	while ( (Length = fread(Block, 1, sizeof(Block), File)) > 0 )
+	{
+		Buffer->insert(Buffer->end(), Block, Block + Length);
+	}
+	fclose(File);
+	return true;
+}
+
+static void FindCommands(SMC100Recorder* Recording, uint8_t Axis, std::vector<RecordedCommand>* Commands)
+{
+	//Frames sent to the axis are split at the new line and the ones an application issues are kept.
+	char Frame[SMC100TransmitBufferSize + 1];
+	uint8_t Length = 0;
+	uint32_t FrameTime = 0;
+	uint8_t GPIOReads = 0;
+	SMC100Recorder::RecordStruct Entry;
+	for (uint32_t Index = 0; Recording->Get(Index, &Entry); ++Index)
+	{
+		if ( (Entry.Axis != Axis) || (Entry.Direction != SMC100Recorder::DirectionType::Transmit) )
+		{
+			continue;
+		}
+		if (Length == 0)
+		{
+			FrameTime = Entry.Time;
+		}
+		if (Entry.Data != '\n')
+		{
+			if (Length < SMC100TransmitBufferSize)
+			{
+				Frame[Length++] = (char)Entry.Data;
+			}
+			continue;
+		}
+		Frame[Length] = '\0';
+		Length = 0;
+		char* Name = Frame;
+		while ( (*Name >= '0') && (*Name <= '9') )
+		{
+			Name++;
+		}
+		if ( (strlen(Name) < 2) || (Name[2] == '?') )
+		{
+			continue;
+		}
+		RecordedCommand Command;
+		Command.Time = FrameTime;
+		Command.Command[0] = Name[0];
+		Command.Command[1] = Name[1];
+		Command.Command[2] = '\0';
+		Command.Parameter = atof(Name + 2);
+		if (strcmp(Command.Command, "RB") == 0)
+		{
+			//The first RB is the one Begin() sends.
+			if (GPIOReads++ == 0)
+			{
+				continue;
+			}
+		}
+		else if ( (strcmp(Command.Command, "PA") != 0) && (strcmp(Command.Command, "OR") != 0) && (strcmp(Command.Command, "SB") != 0) && (strcmp(Command.Command, "MM") != 0) )
+		{
+			continue;
+		}
+		Commands->push_back(Command);
+	}
+}
+
+static void IssueCommand(SMC100* Stage, const RecordedCommand* Command)
+{
+	if (strcmp(Command->Command, "PA") == 0)
+	{
+		Stage->MoveAbsolute(Command->Parameter);
+	}
+	else if (strcmp(Command->Command, "OR") == 0)
+	{
+		Stage->Home();
+	}
+	else if (strcmp(Command->Command, "SB") == 0)
+	{
+		Stage->SetGPIOOutputAll((uint8_t)Command->Parameter);
+	}
+	else if (strcmp(Command->Command, "MM") == 0)
+	{
+		Stage->Enable(Command->Parameter != 0.0);
+	}
+	else if (strcmp(Command->Command, "RB") == 0)
+	{
+		Stage->SendGetGPIOInput();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: %s <dump file> [axis] [baud rate]\n", argv[0]);
+		return 2;
+	}
+	std::vector<uint8_t> Buffer;
+	if (!LoadDump(argv[1], &Buffer) || (Buffer.size() < SMC100RecordSize))
+	{
+		fprintf(stderr, "%s: cannot read a recording from %s\n", argv[0], argv[1]);
+		return 1;
+	}
+	SMC100Recorder Recording(Buffer.data(), Buffer.size());
+	Recording.Restore(Buffer.size() / SMC100RecordSize);
+	Recording.SetEnabled(false);
+	SMC100Recorder::RecordStruct Entry;
+	Recording.Get(0, &Entry);
+	uint8_t Axis = (argc > 2) ? (uint8_t)atoi(argv[2]) : Entry.Axis;
+	uint32_t FirstTime = 0;
+	uint32_t LastTime = 0;
+	uint32_t AxisRecords = 0;
+	for (uint32_t Index = 0; Recording.Get(Index, &Entry); ++Index)
+	{
+		if (Entry.Axis != Axis)
+		{
+			continue;
+		}
+		if (AxisRecords == 0)
+		{
+			FirstTime = Entry.Time;
+		}
+		LastTime = Entry.Time;
+		AxisRecords++;
+	}
+	std::vector<RecordedCommand> Commands;
+	FindCommands(&Recording, Axis, &Commands);
+
+	HostClockVirtual(true);
+	SMC100Replay Replay(&Recording, Axis);
+	SMC100 Stage(&Replay, Axis);
+	if (argc > 3)
+	{
+		Stage.SetBaudRate(strtoul(argv[3], NULL, 10));
+	}
+	Replay.Start();
+	uint32_t StartTime = micros();
+	Stage.Begin();
+	size_t NextCommand = 0;
+	uint32_t SettleStart = 0;
+	bool Settling = false;
+	while (true)
+	{
+		uint32_t ReplayTime = micros() - StartTime + FirstTime;
+		while ( (NextCommand < Commands.size()) && ((int32_t)(ReplayTime - Commands[NextCommand].Time) >= 0) && !Stage.IsQueueFull() )
+		{
+			IssueCommand(&Stage, &Commands[NextCommand]);
+			NextCommand++;
+		}
+		Stage.Check();
+		HostClockAdvance(StepTime);
+		if ( (NextCommand < Commands.size()) || !Replay.IsFinished() )
+		{
+			Settling = false;
+			if ((int32_t)(ReplayTime - LastTime) > (int32_t)(SettleTime * 10))
+			{
+				break;
+			}
+			continue;
+		}
+		if (!Settling)
+		{
+			Settling = true;
+			SettleStart = micros();
+		}
+		if ((micros() - SettleStart) > SettleTime)
+		{
+			break;
+		}
+	}
+
+	const SMC100::ErrorCountStruct* Errors = Stage.GetErrorCounts();
+	printf("axis %u records %u commands %u issued %u\n", Axis, AxisRecords, (unsigned)Commands.size(), (unsigned)NextCommand);
+	printf("replayed %u us finished %s transmit mismatches %u\n", LastTime - FirstTime, Replay.IsFinished() ? "yes" : "no", Replay.GetMismatchCount());
+	printf("replies %u address mismatch %u command mismatch %u overflow %u timeout %u status unknown %u malformed %u command error %u\n",
+		Errors->Replies, Errors->AddressMismatch, Errors->CommandMismatch, Errors->BufferOverflow, Errors->Timeout, Errors->StatusUnknown, Errors->Malformed, Errors->CommandError);
+	printf("position %f status %u\n", Stage.GetPosition(), (unsigned)Stage.GetStatus());
+	return ( Replay.IsFinished() && (Replay.GetMismatchCount() == 0) ) ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+//Simulated controllers on a pty, to test smc100ctl and smc100send.sh without hardware.
+//Usage: smc100sim [address ...]
+//Prints the path of the pty to open as the controller port, then serves until it is killed, e.g.
+//  ./smc100sim 1 > pty.txt &
+//  ./smc100ctl $(head -1 pty.txt) < script.txt
+
+#include <SMC100.h>
+#include <SMC100Simulator.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+const uint32_t StepTime = 20;
+
+int main(int argc, char** argv)
+{
+	int Master = posix_openpt(O_RDWR | O_NOCTTY);
+	if ( (Master < 0) || (grantpt(Master) != 0) || (unlockpt(Master) != 0) )
+	{
+		fprintf(stderr, "%s: cannot create a pty\n", argv[0]);
+		return 1;
+	}
+	fcntl(Master, F_SETFL, O_NONBLOCK);
+	//The slave is held open so the master does not hang up between clients, and made raw so nothing is echoed.
+	int Slave = open(ptsname(Master), O_RDWR | O_NOCTTY);
+	struct termios Settings;
+	if ( (Slave >= 0) && (tcgetattr(Slave, &Settings) == 0) )
+	{
+		cfmakeraw(&Settings);
+		tcsetattr(Slave, TCSANOW, &Settings);
+	}
+	HardwareSerial Port(Master, Master);
+	std::vector<SMC100Simulator*> Controllers;
+	for (int Index = 1; Index < argc; ++Index)
+	{
+		Controllers.push_back(new SMC100Simulator((uint8_t)atoi(argv[Index])));
+	}
+	if (Controllers.empty())
+	{
+		Controllers.push_back(new SMC100Simulator(1));
+	}
+	printf("%s\n", ptsname(Master));
+	fflush(stdout);
+	while (true)
+	{
+		while (Port.available())
+		{
+			uint8_t NewByte = Port.read();
+			for (size_t Index = 0; Index < Controllers.size(); ++Index)
+			{
+				Controllers[Index]->write(NewByte);
+			}
+		}
+		for (size_t Index = 0; Index < Controllers.size(); ++Index)
+		{
+			while (Controllers[Index]->available())
+			{
+				Port.write((uint8_t)Controllers[Index]->read());
+			}
+		}
+		usleep(StepTime);
+	}
+	return 0;
+}
@@ -0,0 +1,37 @@
+//Runs the SMC100Soak example on the host against its simulator, on the virtual clock.
+//Usage: smc100soak [commands]
+//The same seed gives the same success rate and resync histogram on every run.
+
+#include "../../examples/SMC100Soak/SMC100Soak.ino"
+
+const uint32_t StepTime = 5;
+const uint32_t StallTime = 10000000;
+
+int main(int argc, char** argv)
+{
+	uint32_t Limit = (argc > 1) ? strtoul(argv[1], NULL, 10) : CommandTotal;
+	HostClockVirtual(true);
+	setup();
+	uint32_t LastIssued = CommandsIssued;
+	uint32_t LastProgress = micros();
+	while ( (CommandsIssued < Limit) || Stage.IsBusy() )
+	{
+		loop();
+		HostClockAdvance(StepTime);
+		if (CommandsIssued != LastIssued)
+		{
+			LastIssued = CommandsIssued;
+			LastProgress = micros();
+		}
+		else if ((micros() - LastProgress) > StallTime)
+		{
+			Serial.print("<Soak>(Stalled)\n");
+			break;
+		}
+	}
+	if ( (CommandsIssued % ReportEvery) != 0 )
+	{
+		Report();
+	}
+	return (CommandsIssued >= Limit) ? 0 : 1;
+}